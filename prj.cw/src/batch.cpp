@@ -0,0 +1,189 @@
+#include "batch.hpp"
+#include "boundedqueue.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+using namespace misis;
+
+namespace
+{
+    /// \brief Изображение после стадии декодирования.
+    struct DecodedImage
+    {
+        size_t index = 0;
+        std::string path;
+        std::unique_ptr<LoadedImage> loaded; ///< Пусто, если чтение завершилось исключением.
+    };
+
+    /// \brief Результаты изображения после стадии вычисления.
+    struct ComputedImage
+    {
+        size_t index = 0;
+        std::vector<AnalysisResult> results;
+    };
+
+    /// \brief Вызывает функцию при выходе из области видимости, в том числе по исключению.
+    template <typename F>
+    class ScopeExit
+    {
+    public:
+        explicit ScopeExit(F onExit) : onExit(std::move(onExit)) {}
+        ~ScopeExit() { onExit(); }
+        ScopeExit(const ScopeExit&) = delete;
+        ScopeExit& operator=(const ScopeExit&) = delete;
+
+    private:
+        F onExit;
+    };
+
+    /// \brief Результат изображения, которое не удалось прочитать или проанализировать.
+    std::vector<AnalysisResult> invalidResult(const std::string& path)
+    {
+        return { { path, -1, -1, "Invalid" } };
+    }
+}
+
+BatchAnalyzer::BatchAnalyzer(const GLDMExtractor& extractor, const BatchOptions& options)
+    : extractor(extractor)
+    , options(options)
+{
+}
+
+void BatchAnalyzer::setSweep(const std::vector<Real>& alphas, const std::vector<Real>& deltas)
+{
+    sweepAlphas = alphas;
+    sweepDeltas = deltas;
+}
+
+std::vector<AnalysisResult> BatchAnalyzer::compute(const std::string& path, LoadedImage& image) const
+{
+    try
+    {
+        if (!sweepAlphas.empty() && !sweepDeltas.empty())
+            return extractor.analyzeSweepLoaded(path, image, sweepAlphas, sweepDeltas);
+        return { extractor.analyzeLoaded(path, image) };
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Failed to analyze " << path << ": " << e.what() << std::endl;
+        return invalidResult(path);
+    }
+}
+
+void BatchAnalyzer::run(PathSource& paths, const Sink& sink) const
+{
+    const int decodeWorkers = std::max(1, options.decodeWorkers);
+    const int computeWorkers = std::max(1, options.computeWorkers);
+    const size_t window = options.window > 0 ? static_cast<size_t>(options.window) : 4 * static_cast<size_t>(computeWorkers);
+
+    BoundedQueue<DecodedImage> decoded(window, decodeWorkers);
+    BoundedQueue<ComputedImage> computed(window, computeWorkers);
+
+    // Decoders may not run more than `window` images ahead of the output stage.
+    // This bounds the reorder buffer below, which otherwise grows behind a single slow image.
+    std::mutex gateMutex;
+    std::condition_variable gateMoved;
+    size_t emitted = 0;
+    std::atomic<bool> cancelled = false;
+    std::mutex sourceMutex;
+    size_t nextToDecode = 0;
+    bool sourceFailed = false;
+
+    std::vector<std::thread> workers;
+    int decodersStarted = 0;
+    int computersStarted = 0;
+    // Runs on every exit from `run`, including an exception from `sink` or from starting a thread:
+    // stalled stages are released and every worker is joined before the queues go away.
+    const ScopeExit joinWorkers([&] {
+        {
+            std::lock_guard lock(gateMutex);
+            cancelled = true;
+        }
+        gateMoved.notify_all();
+        for (int w = decodersStarted; w < decodeWorkers; ++w)
+            decoded.producerDone();
+        for (int w = computersStarted; w < computeWorkers; ++w)
+            computed.producerDone();
+        ComputedImage rest;
+        while (computed.pop(rest)) {}
+        for (std::thread& worker : workers)
+            worker.join();
+    });
+
+    for (int w = 0; w < decodeWorkers; ++w) {
+        workers.emplace_back([&] {
+            const ScopeExit done([&] { decoded.producerDone(); });
+            for (;;) {
+                DecodedImage image;
+                try
+                {
+                    std::lock_guard lock(sourceMutex);
+                    if (sourceFailed || !paths.next(image.path))
+                        break;
+                    image.index = nextToDecode++;
+                }
+                catch (const std::exception& e)
+                {
+                    // A source that threw (e.g. an unreadable directory) is not asked again, the batch ends with what was read.
+                    std::cerr << "Failed to read the input list: " << e.what() << std::endl;
+                    std::lock_guard lock(sourceMutex);
+                    sourceFailed = true;
+                    break;
+                }
+                {
+                    std::unique_lock lock(gateMutex);
+                    gateMoved.wait(lock, [&] { return cancelled || image.index < emitted + window; });
+                    if (cancelled)
+                        break;
+                }
+                try
+                {
+                    image.loaded = std::make_unique<LoadedImage>();
+                    // A failed decode is reported by the compute stage, which produces the "Invalid" result.
+                    extractor.load(image.path, *image.loaded);
+                }
+                catch (const std::exception& e)
+                {
+                    std::cerr << "Failed to read " << image.path << ": " << e.what() << std::endl;
+                    image.loaded.reset();
+                }
+                decoded.push(std::move(image));
+            }
+        });
+        ++decodersStarted;
+    }
+    for (int w = 0; w < computeWorkers; ++w) {
+        workers.emplace_back([&] {
+            const ScopeExit done([&] { computed.producerDone(); });
+            DecodedImage image;
+            while (decoded.pop(image)) {
+                // After a cancel the remaining images are only drained, their results have nowhere to go.
+                if (cancelled)
+                    continue;
+                ComputedImage result{ image.index, image.loaded ? compute(image.path, *image.loaded) : invalidResult(image.path) };
+                image.loaded.reset();
+                computed.push(std::move(result));
+            }
+        });
+        ++computersStarted;
+    }
+
+    std::map<size_t, std::vector<AnalysisResult>> pending;
+    ComputedImage result;
+    while (computed.pop(result)) {
+        pending.emplace(result.index, std::move(result.results));
+        for (auto it = pending.begin(); it != pending.end() && it->first == emitted; it = pending.begin()) {
+            sink(it->second);
+            pending.erase(it);
+            {
+                std::lock_guard lock(gateMutex);
+                ++emitted;
+            }
+            gateMoved.notify_all();
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#ifndef GLDMBatch_2025
+#define GLDMBatch_2025
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "extractor.hpp"
+#include "pathsource.hpp"
+
+namespace misis
+{
+    /// \brief Параметры конвейера пакетного анализа.
+    struct BatchOptions
+    {
+        int decodeWorkers = 1; ///< Потоки стадии декодирования.
+        int computeWorkers = 1; ///< Потоки стадии вычисления GLDM.
+        int window = 0; ///< Наибольшее число изображений в работе одновременно, 0 - `4 * computeWorkers`.
+    };
+
+    /// \brief Конвейер пакетного анализа изображений.
+    ///
+    /// Стадии декодирования, вычисления и вывода работают в отдельных потоках и связаны
+    /// очередями ограниченной длины. Результаты отдаются в порядке входного списка; число
+    /// изображений между началом декодирования и выводом не превышает `BatchOptions::window`,
+    /// поэтому память не растёт, даже если одно изображение считается намного дольше остальных.
+    class BatchAnalyzer
+    {
+    public:
+        /// \brief Обработчик результатов одного изображения, вызывается из одного потока в порядке входа.
+        using Sink = std::function<void(std::vector<AnalysisResult>& results)>;
+
+        /// \brief Создаёт конвейер поверх настроенного анализатора.
+        /// \param[in] extractor Анализатор; его параметры не должны меняться во время `run`.
+        /// \param[in] options Число потоков и размер окна.
+        BatchAnalyzer(const GLDMExtractor& extractor, const BatchOptions& options);
+
+        /// \brief Включает перебор параметров: для каждого изображения считается `alphas.size() * deltas.size()` результатов.
+        /// \param[in] alphas Перебираемые пороги.
+        /// \param[in] deltas Перебираемые радиусы.
+        void setSweep(const std::vector<Real>& alphas, const std::vector<Real>& deltas);
+
+        /// \brief Анализирует изображения и передаёт результаты в `sink`.
+        ///
+        /// `sink` вызывается в потоке, вызвавшем `run`, по одному разу на изображение.
+        /// Пути запрашиваются у источника по мере того, как освобождается место в окне.
+        /// Исключение при чтении изображения даёт результат "Invalid", исключение источника путей
+        /// завершает пакет на уже прочитанных путях. Исключение из `sink` пробрасывается после того,
+        /// как все потоки конвейера остановлены.
+        /// \param[in] paths Источник путей к изображениям.
+        /// \param[in] sink Обработчик результатов.
+        void run(PathSource& paths, const Sink& sink) const;
+
+    private:
+        /// \brief Вычисляет результаты для изображения, подготовленного `GLDMExtractor::load`.
+        std::vector<AnalysisResult> compute(const std::string& path, LoadedImage& image) const;
+
+        const GLDMExtractor& extractor; ///< Анализатор изображений.
+        BatchOptions options; ///< Параметры конвейера.
+        std::vector<Real> sweepAlphas; ///< Пороги перебора, пусто - обычный анализ.
+        std::vector<Real> sweepDeltas; ///< Радиусы перебора.
+    };
+}
+
+#endif
@@ -0,0 +1,254 @@
+#include "gldm.hpp"
+#include "generator.hpp"
+#include "extractor.hpp"
+#include "resultwriter.hpp"
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+
+/// \brief Результат одного замера: время повторов одной операции.
+struct BenchResult
+{
+    std::string name; ///< Имя замера, например `computeGLDM/noise/d1a5/specialized`.
+    int size = 0; ///< Сторона квадратного изображения.
+    double msMean = 0; ///< Среднее время операции, мс.
+    double msStddev = 0; ///< Стандартное отклонение времени, мс.
+    double mpixMean = 0; ///< Средняя пропускная способность, Мпикс/с.
+    double mpixStddev = 0; ///< Стандартное отклонение пропускной способности, Мпикс/с.
+};
+
+/// \brief Параметры замера `computeGLDM` с явно выбранным ядром.
+struct KernelCase
+{
+    misis::Real delta; ///< Радиус поиска соседей.
+    misis::Real alpha; ///< Порог разности уровней серого.
+    misis::GLDMKernel kernel; ///< Замеряемое ядро.
+    std::string kernelName; ///< Имя ядра в имени замера.
+};
+
+/// \brief Выполняет операцию `repeats` раз после одного прогревочного запуска.
+/// \param[in] name Имя замера.
+/// \param[in] size Сторона изображения.
+/// \param[in] repeats Число замеряемых повторов.
+/// \param[in] operation Замеряемая операция.
+BenchResult measure(const std::string& name, int size, int repeats, const std::function<void()>& operation)
+{
+    operation();
+
+    std::vector<double> ms;
+    for (int r = 0; r < repeats; ++r) {
+        const auto start = std::chrono::steady_clock::now();
+        operation();
+        ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    const double megapixels = static_cast<double>(size) * size / 1e6;
+    BenchResult result{ name, size };
+    for (const double t : ms) {
+        result.msMean += t / ms.size();
+        result.mpixMean += megapixels / (t / 1000.0) / ms.size();
+    }
+    for (const double t : ms) {
+        result.msStddev += (t - result.msMean) * (t - result.msMean) / ms.size();
+        const double mpix = megapixels / (t / 1000.0);
+        result.mpixStddev += (mpix - result.mpixMean) * (mpix - result.mpixMean) / ms.size();
+    }
+    result.msStddev = std::sqrt(result.msStddev);
+    result.mpixStddev = std::sqrt(result.mpixStddev);
+
+    std::cout << std::left << std::setw(44) << name << std::right << std::setw(6) << size
+        << std::fixed << std::setprecision(3)
+        << std::setw(12) << result.msMean << " ms +-" << std::setw(9) << result.msStddev
+        << std::setprecision(1)
+        << std::setw(10) << result.mpixMean << " MPix/s +-" << std::setw(7) << result.mpixStddev
+        << std::defaultfloat << std::endl;
+    return result;
+}
+
+/// \brief Сохраняет результаты в JSON, по записи в строке, чтобы файл служил базой для сравнения.
+bool saveJson(const std::vector<BenchResult>& results, const std::filesystem::path& path)
+{
+    std::ofstream file(path);
+    CheckReturn(file.is_open(), false);
+
+    file << "{\"benchmarks\": [\n";
+    for (size_t k = 0; k < results.size(); ++k) {
+        const BenchResult& result = results[k];
+        std::string name;
+        misis::appendJsonString(name, result.name);
+        file << std::setprecision(9) << "{\"name\": " << name << ", \"size\": " << result.size
+            << ", \"ms_mean\": " << result.msMean << ", \"ms_stddev\": " << result.msStddev
+            << ", \"mpix_per_s\": " << result.mpixMean << ", \"mpix_per_s_stddev\": " << result.mpixStddev
+            << "}" << (k + 1 < results.size() ? "," : "") << "\n";
+    }
+    file << "]}\n";
+    return static_cast<bool>(file);
+}
+
+/// \brief Читает среднее время из файла, записанного `saveJson`.
+/// \return Время по ключу "имя@сторона".
+std::map<std::string, double> loadBaseline(const std::filesystem::path& path)
+{
+    std::map<std::string, double> baseline;
+    std::ifstream file(path);
+    CheckReturn(file.is_open(), baseline);
+
+    const auto field = [](const std::string& line, const std::string& key) {
+        const size_t position = line.find("\"" + key + "\": ");
+        return position == std::string::npos ? std::string() : line.substr(position + key.size() + 4);
+    };
+    std::string line;
+    while (std::getline(file, line)) {
+        const std::string name = field(line, "name");
+        const std::string size = field(line, "size");
+        const std::string ms = field(line, "ms_mean");
+        if (name.size() < 2 || size.empty() || ms.empty())
+            continue;
+        baseline[name.substr(1, name.find('"', 1) - 1) + "@" + std::to_string(std::stoi(size))] = std::stod(ms);
+    }
+    return baseline;
+}
+
+/// \brief Разбирает список чисел через запятую.
+std::vector<int> parseIntList(const std::string& text)
+{
+    std::vector<int> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+        if (!item.empty())
+            values.push_back(std::stoi(item));
+    return values;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<int> sizes = { 256, 512, 1024, 2048, 4096, 8192 };
+    int repeats = 5;
+    int threads = 1;
+    std::filesystem::path jsonPath;
+    std::filesystem::path baselinePath;
+    double tolerance = 0.10;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--sizes" && i + 1 < argc)
+            sizes = parseIntList(argv[++i]);
+        else if (arg == "--repeat" && i + 1 < argc)
+            repeats = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = std::stoi(argv[++i]);
+        else if (arg == "--json" && i + 1 < argc)
+            jsonPath = argv[++i];
+        else if (arg == "--baseline" && i + 1 < argc)
+            baselinePath = argv[++i];
+        else if (arg == "--tolerance" && i + 1 < argc)
+            tolerance = std::stod(argv[++i]);
+        else {
+            std::cout << "Usage: gldm_bench [--sizes 256,...,8192] [--repeat <int>] [--threads <int>]\n"
+                << "                  [--json <out.json>] [--baseline <old.json>] [--tolerance <fraction>]\n";
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    // Auto picks the specialized kernel for delta 1-3, so the other kernels are requested explicitly on the same windows.
+    // Delta 8 (17x17, 288 neighbours) is past the 8-bit SIMD counters and shows where Auto falls back to the scalar loop.
+    const std::vector<KernelCase> parameters = {
+        { 1, 0, misis::GLDMKernel::Specialized, "specialized" },
+        { 1, 5, misis::GLDMKernel::Specialized, "specialized" },
+        { 1, 5, misis::GLDMKernel::Simd, "simd" },
+        { 1, 5, misis::GLDMKernel::Scalar, "scalar" },
+        { 2, 5, misis::GLDMKernel::Specialized, "specialized" },
+        { 2, 5, misis::GLDMKernel::Simd, "simd" },
+        { 3, 10, misis::GLDMKernel::Specialized, "specialized" },
+        { 3, 10, misis::GLDMKernel::Scalar, "scalar" },
+        { 5, 5, misis::GLDMKernel::Simd, "simd" },
+        { 5, 5, misis::GLDMKernel::Scalar, "scalar" },
+        { 8, 5, misis::GLDMKernel::Scalar, "scalar" },
+    };
+    const std::filesystem::path tempDir = std::filesystem::temp_directory_path() / "gldm_bench";
+    std::filesystem::create_directories(tempDir);
+
+    std::vector<BenchResult> results;
+    for (const int size : sizes) {
+        GLDMFeatureImageGenerator generator(size, size);
+        const std::vector<std::pair<std::string, std::function<cv::Mat()>>> patterns = {
+            { "noise", [&] { return generator.generateRandomNoiseImage(); } },
+            { "blocks", [&] { return generator.generateHighDependenceUniformityImage(); } },
+            { "gradient", [&] { return generator.generateGradientImage(); } },
+        };
+
+        for (const auto& [pattern, generate] : patterns) {
+            misis::GLDM gldm;
+            gldm.importImageFromMat(generate());
+
+            for (const KernelCase& parameter : parameters) {
+                const std::string suffix = "/" + pattern + "/d" + std::to_string(static_cast<int>(parameter.delta))
+                    + "a" + std::to_string(static_cast<int>(parameter.alpha)) + "/" + parameter.kernelName;
+                results.push_back(measure("computeGLDM" + suffix, size, repeats, [&] {
+                    gldm.computeGLDM(parameter.delta, parameter.alpha, parameter.kernel, threads);
+                }));
+            }
+
+            // The getters read the matrix of the last computeGLDM call; throughput is still per image pixel.
+            results.push_back(measure("computeAllFeatures/" + pattern, size, repeats, [&] {
+                volatile double sink = gldm.computeAllFeatures().DN;
+                (void)sink;
+            }));
+            results.push_back(measure("getLowGrayLevelEmphasis/" + pattern, size, repeats, [&] {
+                volatile double sink = gldm.getLowGrayLevelEmphasisFeatureValue();
+                (void)sink;
+            }));
+            results.push_back(measure("getDependenceNonUniformity/" + pattern, size, repeats, [&] {
+                volatile double sink = gldm.getDependenceNonUniformityFeatureValue();
+                (void)sink;
+            }));
+
+            // The full path includes reading and decoding a file, so the image is saved once in both formats.
+            for (const std::string extension : { ".png", ".pgm" }) {
+                const std::string path = (tempDir / (pattern + "_" + std::to_string(size) + extension)).string();
+                misis::GLDMExtractor extractor;
+                extractor.setParams(5, 1);
+                extractor.setThreads(threads);
+                if (!cv::imwrite(path, gldm.getImage()) || extractor.analyze(path).category == "Invalid") {
+                    std::cerr << "Skipping analyze" << extension << " at " << size << ": the image could not be written or read back" << std::endl;
+                    std::filesystem::remove(path);
+                    continue;
+                }
+                results.push_back(measure("analyze" + extension + "/" + pattern, size, repeats, [&] {
+                    volatile double sink = extractor.analyze(path).DN;
+                    (void)sink;
+                }));
+                std::filesystem::remove(path);
+            }
+        }
+    }
+
+    if (!jsonPath.empty()) {
+        CheckReturn(saveJson(results, jsonPath), 1);
+        std::cout << "Benchmark results written to: " << jsonPath.string() << std::endl;
+    }
+
+    if (baselinePath.empty())
+        return 0;
+    const std::map<std::string, double> baseline = loadBaseline(baselinePath);
+    int regressions = 0;
+    for (const BenchResult& result : results) {
+        const auto it = baseline.find(result.name + "@" + std::to_string(result.size));
+        // Operations under 10 us are dominated by timer noise and are not compared.
+        if (it == baseline.end() || it->second < 0.01)
+            continue;
+        const double change = result.msMean / it->second - 1.0;
+        if (change > tolerance) {
+            std::cout << "REGRESSION " << result.name << " " << result.size << ": " << std::fixed << std::setprecision(1)
+                << 100.0 * change << "% slower than the baseline" << std::defaultfloat << std::endl;
+            ++regressions;
+        }
+    }
+    std::cout << regressions << " regression(s) against " << baselinePath.string() << std::endl;
+    return regressions > 0 ? 2 : 0;
+}
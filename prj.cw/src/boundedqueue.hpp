@@ -0,0 +1,67 @@
+#pragma once
+
+#ifndef GLDMBoundedQueue_2025
+#define GLDMBoundedQueue_2025
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace misis
+{
+    /// \brief Очередь ограниченной длины между стадиями конвейера.
+    ///
+    /// `push` ждёт свободного места, `pop` - элемента. Очередь закрывается, когда закончили
+    /// работу все производители; после этого `pop` дочитывает остаток и возвращает `false`.
+    template <typename T>
+    class BoundedQueue
+    {
+    public:
+        /// \param[in] capacity Наибольшее число элементов.
+        /// \param[in] producers Число потоков, вызывающих `push`.
+        BoundedQueue(size_t capacity, int producers)
+            : capacity(std::max<size_t>(capacity, 1))
+            , producers(producers)
+        {
+        }
+
+        void push(T item)
+        {
+            std::unique_lock lock(mutex);
+            notFull.wait(lock, [&] { return items.size() < capacity; });
+            items.push_back(std::move(item));
+            notEmpty.notify_one();
+        }
+
+        bool pop(T& item)
+        {
+            std::unique_lock lock(mutex);
+            notEmpty.wait(lock, [&] { return !items.empty() || producers == 0; });
+            if (items.empty())
+                return false;
+            item = std::move(items.front());
+            items.pop_front();
+            notFull.notify_one();
+            return true;
+        }
+
+        /// \brief Отмечает, что один из производителей закончил работу.
+        void producerDone()
+        {
+            std::lock_guard lock(mutex);
+            if (--producers == 0)
+                notEmpty.notify_all();
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable notFull;
+        std::condition_variable notEmpty;
+        std::deque<T> items;
+        size_t capacity;
+        int producers;
+    };
+}
+
+#endif
@@ -0,0 +1,106 @@
+#include "calibration.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using namespace misis;
+
+namespace
+{
+    /// \brief Анализирует изображение и возвращает время в миллисекундах.
+    double timedAnalyze(const GLDMExtractor& extractor, const std::string& imagePath, AnalysisResult& result)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        result = extractor.analyze(imagePath);
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+DecodeCalibration::DecodeCalibration(const GLDMExtractor& extractor, int reduction)
+    : full(extractor)
+    , reduced(extractor)
+    , reduction(reduction)
+{
+    for (GLDMExtractor* pass : { &full, &reduced }) {
+        pass->setCache(nullptr, CacheMode::Off);
+        pass->setStreaming(false);
+        pass->setFeatureMapWindow(0);
+        pass->setKeepImages(false);
+    }
+    full.setDecodeReduction(1);
+    reduced.setDecodeReduction(reduction);
+}
+
+void DecodeCalibration::add(const std::string& imagePath)
+{
+    AnalysisResult fullResult, reducedResult;
+    Sample sample;
+    sample.imageName = imagePath;
+    sample.fullMs = timedAnalyze(full, imagePath, fullResult);
+    sample.reducedMs = timedAnalyze(reduced, imagePath, reducedResult);
+    if (fullResult.category == "Invalid" || reducedResult.category == "Invalid")
+        return;
+
+    const auto fullValues = fullResult.features.values();
+    const auto reducedValues = reducedResult.features.values();
+    for (size_t k = 0; k < GLDMFeatureSet::size; ++k) {
+        // A zero reference value has no relative scale; the absolute difference is reported instead.
+        const double difference = std::abs(reducedValues[k] - fullValues[k]);
+        sample.relativeError[k] = fullValues[k] != 0 ? difference / std::abs(fullValues[k]) : difference;
+    }
+    sample.sameCategory = fullResult.category == reducedResult.category;
+    samples.push_back(std::move(sample));
+}
+
+bool DecodeCalibration::saveReport(const std::string& output_path) const
+{
+    std::string outName = output_path + "calibration.csv";
+    std::ofstream file(outName);
+
+    CheckReturn(file.is_open(), false);
+
+    file << "image,full_ms,reduced_ms,same_category";
+    for (const std::string_view name : GLDMFeatureSet::names)
+        file << ',' << name << "_rel_error";
+    file << '\n';
+
+    std::array<double, GLDMFeatureSet::size> meanError{};
+    std::array<double, GLDMFeatureSet::size> maxError{};
+    double fullMs = 0, reducedMs = 0;
+    size_t sameCategory = 0;
+
+    file << std::setprecision(6);
+    for (const Sample& sample : samples) {
+        file << sample.imageName << ',' << sample.fullMs << ',' << sample.reducedMs << ',' << (sample.sameCategory ? 1 : 0);
+        for (size_t k = 0; k < GLDMFeatureSet::size; ++k) {
+            file << ',' << sample.relativeError[k];
+            meanError[k] += sample.relativeError[k];
+            maxError[k] = std::max(maxError[k], sample.relativeError[k]);
+        }
+        file << '\n';
+        fullMs += sample.fullMs;
+        reducedMs += sample.reducedMs;
+        sameCategory += sample.sameCategory ? 1 : 0;
+    }
+    file.close();
+    CheckReturn(static_cast<bool>(file), false);
+    std::cout << "Calibration table written to: " << outName << '\n';
+
+    if (samples.empty()) {
+        std::cout << "No images were analyzed in both resolutions\n";
+        return true;
+    }
+
+    const double count = static_cast<double>(samples.size());
+    std::cout << "Reduced decode 1/" << reduction << " on " << samples.size() << " images\n"
+        << std::fixed << std::setprecision(2)
+        << "  time full: " << fullMs << " ms, reduced: " << reducedMs << " ms, speedup: " << (reducedMs > 0 ? fullMs / reducedMs : 0.0) << "x\n"
+        << "  same category: " << 100.0 * sameCategory / count << "%\n"
+        << std::setprecision(4)
+        << "  feature    mean rel. error    max rel. error\n";
+    for (size_t k = 0; k < GLDMFeatureSet::size; ++k)
+        std::cout << "  " << std::left << std::setw(10) << GLDMFeatureSet::names[k] << std::right
+            << std::setw(16) << meanError[k] / count << std::setw(18) << maxError[k] << '\n';
+    std::cout << std::defaultfloat;
+    return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#ifndef GLDMCalibration_2025
+#define GLDMCalibration_2025
+
+#include <array>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "extractor.hpp"
+
+namespace misis
+{
+    /// \brief Оценивает погрешность быстрого декодирования (`GLDMExtractor::setDecodeReduction`).
+    ///
+    /// Каждое изображение анализируется дважды - в полном и в уменьшенном разрешении, - с замером
+    /// времени. Кэш матриц при этом не используется, чтобы время отражало декодирование и вычисление.
+    class DecodeCalibration final
+    {
+    public:
+        /// \param[in] extractor Настроенный анализатор; его параметры GLDM используются для обоих проходов.
+        /// \param[in] reduction Проверяемое уменьшение: 2, 4 или 8.
+        DecodeCalibration(const GLDMExtractor& extractor, int reduction);
+
+        /// \brief Анализирует изображение в обоих разрешениях и запоминает расхождение.
+        /// \param[in] imagePath Путь к изображению.
+        void add(const std::string& imagePath);
+
+        /// \brief Сохраняет таблицу `calibration.csv` по изображениям и выводит сводку в консоль.
+        /// \param[in] output_path Папка для сохранения.
+        /// \return `false`, если файл не удалось записать.
+        bool saveReport(const std::string& output_path) const;
+
+    private:
+        /// \brief Результаты одного изображения.
+        struct Sample
+        {
+            std::string imageName; ///< Путь к изображению.
+            std::array<double, GLDMFeatureSet::size> relativeError{}; ///< |reduced - full| / |full| по признакам.
+            bool sameCategory = false; ///< Категория не изменилась.
+            double fullMs = 0; ///< Время анализа в полном разрешении, мс.
+            double reducedMs = 0; ///< Время анализа в уменьшенном разрешении, мс.
+        };
+
+        GLDMExtractor full; ///< Анализатор в полном разрешении.
+        GLDMExtractor reduced; ///< Анализатор в уменьшенном разрешении.
+        int reduction; ///< Проверяемое уменьшение.
+        std::vector<Sample> samples; ///< Результаты по изображениям.
+    };
+}
+
+#endif
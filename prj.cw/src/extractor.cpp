@@ -1,7 +1,13 @@
 #include "extractor.hpp"
 #include "gldm.hpp"
+#include "profiler.hpp"
+#include "resultwriter.hpp"
+
+void misis::GLDMExtractor::saveSummaryToFile(const std::string& originalName, const std::string& output_path, const GLDMFeatureSet& features) const {
+    GLDM_PROFILE_SCOPE("GLDMExtractor::saveSummary");
+    const double LGLE = features.LGLE;
+    const double DN = features.DN;
 
-void misis::GLDMExtractor::saveSummaryToFile(const std::string& originalName, const std::string& output_path, misis::Real LGLE, misis::Real DN) {
     std::string outName = output_path + "summary_" + originalName + ".txt";
     std::ofstream file(outName);
 
@@ -24,49 +30,306 @@ void misis::GLDMExtractor::saveSummaryToFile(const std::string& originalName, co
     else
         file << "- High DN suggests complex or heterogeneous texture patterns.\n";
 
+    file << "\nAll GLDM features:\n";
+    const auto values = features.values();
+    for (size_t k = 0; k < GLDMFeatureSet::size; ++k)
+        file << GLDMFeatureSet::names[k] << ": " << values[k] << "\n";
+
     file.close();
     std::cout << "Summary written to: " << outName << std::endl;
 }
 
-void misis::GLDMExtractor::analyzeAndSaveSummary(const std::string& imagePath, const std::string& output_path) {
+misis::AnalysisResult misis::GLDMExtractor::analyzeAndSaveSummary(const std::string& imagePath, const std::string& output_path) const {
+    AnalysisResult result = analyze(imagePath);
+    saveSummary(result, output_path);
+    return result;
+}
 
-    misis::GLDM gldm(imagePath, alpha, delta);
-    double LGLE = gldm.getLowGrayLevelEmphasisFeatureValue();
-    double DN = gldm.getDependenceNonUniformityFeatureValue();
+void misis::GLDMExtractor::saveSummary(const AnalysisResult& result, const std::string& output_path) const
+{
+    if (result.category == "Invalid")
+        return;
 
-    size_t pos = imagePath.find_last_of("/\\");
-    std::string nameOnly = (pos != std::string::npos) ? imagePath.substr(pos + 1) : imagePath;
+    size_t pos = result.imageName.find_last_of("/\\");
+    std::string nameOnly = (pos != std::string::npos) ? result.imageName.substr(pos + 1) : result.imageName;
 
-    saveSummaryToFile(nameOnly, output_path, LGLE, DN);
+    saveSummaryToFile(nameOnly, output_path, result.features);
 }
 
-void misis::GLDMExtractor::setParams(const Real alpha, const Real delta)
+bool misis::GLDMExtractor::setParams(const Real alpha, const Real delta)
 {
+    CheckReturn(GLDM::isValidDelta(delta, quantization.grayLevels), false);
     this->alpha = alpha;
     this->delta = delta;
+    kernel = GLDM::selectKernel(delta, alpha);
+    return true;
+}
+
+void misis::GLDMExtractor::setThreads(int threads)
+{
+    this->threads = threads;
+}
+
+void misis::GLDMExtractor::setStreaming(bool streaming)
+{
+    this->streaming = streaming;
+}
+
+bool misis::GLDMExtractor::setQuantization(const GLDMQuantization& levels)
+{
+    CheckReturn(GLDM::isValidQuantization(levels), false);
+    quantization = levels;
+    return true;
+}
+
+bool misis::GLDMExtractor::setDecodeReduction(int reduction)
+{
+    CheckReturn(reduction == 1 || reduction == 2 || reduction == 4 || reduction == 8, false);
+    decodeReduction = reduction;
+    return true;
+}
+
+bool misis::GLDMExtractor::isStreamingRead() const
+{
+    // Strips are always read at full resolution, so a reduced decode takes precedence.
+    return streaming && decodeReduction == 1;
+}
+
+misis::GLDMCacheKey misis::GLDMExtractor::cacheKey(const LoadedImage& image, Real delta, Real alpha) const
+{
+    return image.contentKey.withParameters(delta, alpha, quantization, decodeReduction);
 }
 
-misis::AnalysisResult misis::GLDMExtractor::analyze(const std::string& imagePath)
+bool misis::GLDMExtractor::computeMatrix(const std::string& imagePath, GLDM& gldm) const
 {
-        cv::Mat image = cv::imread(imagePath, cv::IMREAD_GRAYSCALE);
-        if (image.empty()) {
+    if (gldm.isMatrixComputed())
+        return true;
+    gldm.setQuantization(quantization);
+    if (gldm.isImageLoaded()) {
+        gldm.computeGLDM(delta, alpha, kernel, threads);
+        return gldm.isMatrixComputed();
+    }
+    // Without streaming `load` has already tried to decode the file.
+    if (!isStreamingRead())
+        return false;
+    if (gldm.computeGLDMStreaming(imagePath, delta, alpha, kernel))
+        return true;
+    std::cerr << "Streaming is not supported for " << imagePath << ", decoding the whole image" << std::endl;
+
+    return gldm.readImage(imagePath, alpha, delta, threads, kernel);
+}
+
+bool misis::GLDMExtractor::load(const std::string& imagePath, LoadedImage& image) const
+{
+    GLDM_PROFILE_SCOPE("GLDMExtractor::load");
+    image.gldm.setQuantization(quantization);
+    image.hasContentKey = false;
+    if (cache && cacheMode != CacheMode::Off) {
+        GLDM_PROFILE_SCOPE("GLDMExtractor::cacheLookup");
+        // Hashing reads the raw file bytes, which is far cheaper than decoding them.
+        image.hasContentKey = GLDMCacheKey::fromFile(imagePath, image.contentKey);
+        GLDMMatrix cached;
+        if (image.hasContentKey && cacheMode == CacheMode::ReadWrite
+            && cache->load(cacheKey(image, delta, alpha), cached)) {
+            image.gldm.releaseImage();
+            image.gldm.setMatrix(std::move(cached));
+            return true;
+        }
+    }
+
+    // Streaming reads pixels inside the compute step itself, so there is nothing to decode up front.
+    if (isStreamingRead()) {
+        image.gldm.releaseImage();
+        return true;
+    }
+    if (image.gldm.loadImage(imagePath, decodeReduction))
+        return true;
+    image.gldm.releaseImage();
+    return false;
+}
+
+misis::AnalysisResult misis::GLDMExtractor::analyze(const std::string& imagePath) const
+{
+        LoadedImage image;
+        load(imagePath, image);
+        return analyzeLoaded(imagePath, image);
+}
+
+misis::AnalysisResult misis::GLDMExtractor::analyzeLoaded(const std::string& imagePath, LoadedImage& image) const
+{
+        GLDM_PROFILE_SCOPE("GLDMExtractor::analyze");
+        GLDM& gldm = image.gldm;
+        const bool fromCache = gldm.isMatrixComputed();
+        if (!computeMatrix(imagePath, gldm)) {
             std::cerr << "Failed to load image: " << imagePath << std::endl;
             return { imagePath, -1, -1, "Invalid" };
         }
+        if (!fromCache && image.hasContentKey) {
+            GLDM_PROFILE_SCOPE("GLDMExtractor::cacheStore");
+            cache->store(cacheKey(image, delta, alpha), gldm.getMatrix());
+        }
+
+        const GLDMFeatureSet features = scaleToFullResolution(gldm.computeAllFeatures(), decodeReduction);
+        double LGLE = features.LGLE;
+        double DN = features.DN;
+
+        AnalysisResult result{ imagePath, LGLE, DN, classify(LGLE, DN), alpha, delta, features };
+
+        // The streaming path never holds the whole image; only decode it when a consumer actually needs pixels.
+        if ((featureMapWindow > 0 || keepImages) && !gldm.isImageLoaded() && !gldm.loadImage(imagePath, decodeReduction))
+            std::cerr << "Failed to decode image for feature maps or display: " << imagePath << std::endl;
+        if (featureMapWindow > 0 && gldm.isImageLoaded())
+            result.maps = gldm.computeFeatureMaps(featureMapWindow, delta, alpha, threads);
+        if (keepImages)
+            result.image = gldm.getImage();
+
+        return result;
+}
+
+misis::AnalysisResult misis::GLDMExtractor::analyzeEncoded(const std::string& imageName, const std::vector<uchar>& bytes) const
+{
+    LoadedImage image;
+    return analyzeEncoded(imageName, bytes, image);
+}
+
+misis::AnalysisResult misis::GLDMExtractor::analyzeEncoded(const std::string& imageName, const std::vector<uchar>& bytes, LoadedImage& image) const
+{
+    image.gldm.setQuantization(quantization);
+    image.hasContentKey = false;
+    if (!image.gldm.decodeImage(bytes.data(), bytes.size(), decodeReduction)) {
+        std::cerr << "Failed to decode image: " << imageName << std::endl;
+        return { imageName, -1, -1, "Invalid" };
+    }
+    return analyzeLoaded(imageName, image);
+}
+
+std::string misis::GLDMExtractor::classify(double LGLE, double DN)
+{
+    if (LGLE > 0.1 && DN < 500)
+        return "Uniform Texture with Low Gray Levels";
+    else if (LGLE > 0.1 && DN >= 500)
+        return "Heterogeneous Texture with Low Gray Levels";
+    else if (LGLE <= 0.1 && DN < 500)
+        return "Uniform Texture with Mixed Gray Levels";
+    else
+        return "Heterogeneous Texture with Mixed or High Gray Levels";
+}
+
+misis::GLDMFeatureSet misis::GLDMExtractor::scaleToFullResolution(GLDMFeatureSet features, int reduction)
+{
+    // GLN and DN are sums of squared marginals over Nz, so they grow with the pixel count,
+    // which a reduced decode divides by N^2; the other features are ratios and need no correction.
+    const double pixelRatio = static_cast<double>(reduction) * reduction;
+    features.GLN *= pixelRatio;
+    features.DN *= pixelRatio;
+    return features;
+}
+
+std::vector<misis::AnalysisResult> misis::GLDMExtractor::analyzeSweep(const std::string& imagePath, const std::vector<Real>& alphas, const std::vector<Real>& deltas) const
+{
+    LoadedImage image;
+    load(imagePath, image);
+    return analyzeSweepLoaded(imagePath, image, alphas, deltas);
+}
+
+std::vector<misis::AnalysisResult> misis::GLDMExtractor::analyzeSweepLoaded(const std::string& imagePath, LoadedImage& image, const std::vector<Real>& alphas, const std::vector<Real>& deltas) const
+{
+    GLDM_PROFILE_SCOPE("GLDMExtractor::analyzeSweep");
+    GLDM& gldm = image.gldm;
+    std::vector<GLDMMatrix> matrices(alphas.size() * deltas.size());
+
+    // The whole grid comes from one traversal, so it is only skipped when every pair is cached.
+    bool allCached = image.hasContentKey && cacheMode == CacheMode::ReadWrite;
+    for (size_t a = 0; a < alphas.size() && allCached; ++a)
+        for (size_t d = 0; d < deltas.size() && allCached; ++d)
+            allCached = cache->load(cacheKey(image, deltas[d], alphas[a]), matrices[a * deltas.size() + d]);
+
+    if (!allCached) {
+        gldm.setQuantization(quantization);
+        if (!gldm.isImageLoaded() && !gldm.loadImage(imagePath, decodeReduction)) {
+            std::cerr << "Failed to load image: " << imagePath << std::endl;
+            return { { imagePath, -1, -1, "Invalid" } };
+        }
+
+        matrices = gldm.computeSweep(deltas, alphas, threads);
+        if (image.hasContentKey && matrices.size() == alphas.size() * deltas.size())
+            for (size_t a = 0; a < alphas.size(); ++a)
+                for (size_t d = 0; d < deltas.size(); ++d)
+                    cache->store(cacheKey(image, deltas[d], alphas[a]), matrices[a * deltas.size() + d]);
+    }
+    if (keepImages && !gldm.isImageLoaded())
+        gldm.loadImage(imagePath, decodeReduction);
+    const cv::Mat decoded = keepImages ? gldm.getImage() : cv::Mat();
+
+    std::vector<AnalysisResult> results;
+    for (size_t a = 0; a < alphas.size(); ++a) {
+        for (size_t d = 0; d < deltas.size(); ++d) {
+            GLDM_PROFILE_SCOPE("GLDMExtractor::sweepFeatures");
+            const GLDMFeatureSet features = scaleToFullResolution(matrices[a * deltas.size() + d].computeAllFeatures(), decodeReduction);
+            results.push_back({ imagePath, features.LGLE, features.DN, classify(features.LGLE, features.DN), alphas[a], deltas[d], features, decoded });
+        }
+    }
+    return results;
+}
 
-        misis::GLDM gldm(imagePath, alpha, delta);
-        double LGLE = gldm.getLowGrayLevelEmphasisFeatureValue();
-        double DN = gldm.getDependenceNonUniformityFeatureValue();
-
-        std::string category;
-        if (LGLE > 0.1 && DN < 500)
-            category = "Uniform Texture with Low Gray Levels";
-        else if (LGLE > 0.1 && DN >= 500)
-            category = "Heterogeneous Texture with Low Gray Levels";
-        else if (LGLE <= 0.1 && DN < 500)
-            category = "Uniform Texture with Mixed Gray Levels";
-        else
-            category = "Heterogeneous Texture with Mixed or High Gray Levels";
-
-        return { imagePath, LGLE, DN, category };
+void misis::GLDMExtractor::saveSweepSummary(const std::vector<AnalysisResult>& results, const std::string& output_path) const
+{
+    GLDM_PROFILE_SCOPE("GLDMExtractor::saveSweepSummary");
+    std::string outName = output_path + "sweep_summary.csv";
+    std::ofstream file(outName);
+
+    CheckReturn_Void(file.is_open());
+
+    file << "image,alpha,delta";
+    for (const std::string_view name : GLDMFeatureSet::names)
+        file << ',' << name;
+    file << ",category\n";
+
+    file << std::setprecision(9);
+    std::string field;
+    for (const AnalysisResult& result : results) {
+        // Image names may contain commas or quotes, so they are escaped the same way as in results.csv.
+        field.clear();
+        appendCsvField(field, result.imageName);
+        file << field << ',' << result.alpha << ',' << result.delta;
+        for (const double value : result.features.values())
+            file << ',' << value;
+        field.clear();
+        appendCsvField(field, result.category);
+        file << ',' << field << '\n';
+    }
+
+    file.close();
+    std::cout << "Sweep summary written to: " << outName << std::endl;
+}
+
+void misis::GLDMExtractor::saveFeatureMaps(const AnalysisResult& result, const std::string& output_path) const
+{
+    if (result.category == "Invalid")
+        return;
+    CheckReturn_Void(!result.maps.LGLE.empty() && !result.maps.DN.empty());
+    GLDM_PROFILE_SCOPE("GLDMExtractor::saveFeatureMaps");
+
+    size_t pos = result.imageName.find_last_of("/\\");
+    std::string nameOnly = (pos != std::string::npos) ? result.imageName.substr(pos + 1) : result.imageName;
+
+    cv::imwrite(output_path + nameOnly + "_lgle_map.tiff", result.maps.LGLE);
+    cv::imwrite(output_path + nameOnly + "_dn_map.tiff", result.maps.DN);
+    std::cout << "Feature maps written to: " << output_path + nameOnly + "_{lgle,dn}_map.tiff" << std::endl;
+}
+
+void misis::GLDMExtractor::setFeatureMapWindow(int windowSize)
+{
+    featureMapWindow = windowSize;
+}
+
+void misis::GLDMExtractor::setKeepImages(bool keep)
+{
+    keepImages = keep;
+}
+
+void misis::GLDMExtractor::setCache(std::shared_ptr<GLDMCache> matrixCache, CacheMode mode)
+{
+    cache = std::move(matrixCache);
+    cacheMode = cache ? mode : CacheMode::Off;
 }
@@ -9,6 +9,8 @@
 #include <sstream>
 #include <iomanip>
 #include "gldm.hpp"
+#include "gldmcache.hpp"
+#include <memory>
 
 namespace misis
 {
@@ -24,6 +26,18 @@ namespace misis
     double LGLE; ///< Признак низкого уровня серого.
     double DN; ///< Признак неравномерности.
     std::string category; ///< Категория итогово изображения.
+    Real alpha = 0; ///< Порог alpha, с которым получен результат.
+    Real delta = 0; ///< Радиус delta, с которым получен результат.
+    GLDMFeatureSet features; ///< Полный набор признаков GLDM.
+    cv::Mat image; ///< Декодированное изображение, если включено `setKeepImages`.
+    GLDMFeatureMaps maps; ///< Карты локальных признаков, если задано `setFeatureMapWindow`.
+};
+
+    /// \brief Изображение, подготовленное `GLDMExtractor::load` к вычислению.
+    struct LoadedImage {
+    GLDM gldm; ///< Декодированное изображение или матрица, найденная в кэше.
+    GLDMCacheKey contentKey; ///< Хеш содержимого файла для поиска в кэше.
+    bool hasContentKey = false; ///< Файл захеширован (кэш включён).
 };
 
      /// \brief Класс для анализа изображений с использованием GLDM.
@@ -41,26 +55,162 @@ namespace misis
          /// \brief Анализирует изображение и сохраняет результаты в файл.
          /// \param[in] imagePath Путь к исходному изображению.
          /// \param[in] output_path Путь к файлу для соранения результатов.
-        void analyzeAndSaveSummary(const std::string& imagePath, const std::string& output_path);
+         /// \return Результат анализа, тот же, что вернул бы `analyze`.
+        AnalysisResult analyzeAndSaveSummary(const std::string& imagePath, const std::string& output_path) const;
 
         /// \brief Выполняет анализ изображения и возвращает результаты.
+        ///
+        /// Изображение декодируется и матрица вычисляется ровно один раз; сохранение сводки,
+        /// карт признаков и отображение в GUI используют готовый результат.
         /// \param[in] ImagePath Путь к анализируемому изображению..
-        AnalysisResult analyze(const std::string& ImagePath);
+        AnalysisResult analyze(const std::string& ImagePath) const;
+
+        /// \brief Декодирует изображение для последующего `analyzeLoaded`.
+        ///
+        /// Вместе с `analyzeLoaded` разбивает `analyze` на стадию чтения и стадию вычисления,
+        /// которые могут выполняться в разных потоках. Если включён кэш и матрица для текущих
+        /// параметров в нём есть, изображение не декодируется. При построчном чтении тоже ничего
+        /// не декодирует: пиксели читаются прямо при вычислении.
+        /// \param[in] imagePath Путь к изображению.
+        /// \param[in,out] image Подготовленное изображение. Объект можно передавать повторно:
+        ///                     буферы изображения и матрицы прошлого вызова используются снова.
+        /// \return `false`, если изображение не удалось прочитать.
+        bool load(const std::string& imagePath, LoadedImage& image) const;
+
+        /// \brief Анализирует изображение, подготовленное `load`.
+        /// \param[in] imagePath Путь к изображению.
+        /// \param[in,out] image Изображение, переданное в `load`.
+        AnalysisResult analyzeLoaded(const std::string& imagePath, LoadedImage& image) const;
+
+        /// \brief Анализирует изображение, переданное содержимым файла, а не путём.
+        ///
+        /// Кэш матриц не используется: у изображения нет файла, по которому строится ключ.
+        /// \param[in] imageName Имя изображения для результата.
+        /// \param[in] bytes Закодированное изображение (PNG, JPEG, PGM и т. д.).
+        AnalysisResult analyzeEncoded(const std::string& imageName, const std::vector<uchar>& bytes) const;
+
+        /// \brief Анализирует закодированное изображение, декодируя его в буферы `image`.
+        /// \param[in] imageName Имя изображения для результата.
+        /// \param[in] bytes Закодированное изображение.
+        /// \param[in,out] image Буферы, которые используются повторно от запроса к запросу.
+        AnalysisResult analyzeEncoded(const std::string& imageName, const std::vector<uchar>& bytes, LoadedImage& image) const;
+
+        /// \brief Сохраняет сводку по уже полученному результату анализа.
+        /// \param[in] result Результат `analyze`.
+        /// \param[in] output_path Папка для сохранения.
+        void saveSummary(const AnalysisResult& result, const std::string& output_path) const;
 
          /// \brief Устанавливает параметры alpha и delta для GLDM.
+         ///
+         /// Здесь же выбирается ядро подсчёта соседей, которое затем используется для всех изображений.
          /// \param[in] alpha Кастомная альфа.
-         /// \param[in] delta Кастомная дельта.
-        void setParams(const Real alpha, const Real delta);
+         /// \param[in] delta Кастомная дельта, от 0 до `GLDM::maxDeltaFor` для текущего квантования.
+         /// \return `false`, если delta вне допустимого диапазона; параметры при этом не меняются.
+        bool setParams(const Real alpha, const Real delta);
+
+        /// \brief Анализирует изображение для всех сочетаний alpha и delta за один обход.
+        /// \param[in] imagePath Путь к анализируемому изображению.
+        /// \param[in] alphas Перебираемые пороги.
+        /// \param[in] deltas Перебираемые радиусы.
+        /// \return По одному результату на пару (alpha, delta), alpha - внешний цикл.
+        std::vector<AnalysisResult> analyzeSweep(const std::string& imagePath, const std::vector<Real>& alphas, const std::vector<Real>& deltas) const;
+
+        /// \brief Перебор параметров для изображения, подготовленного `load`.
+        /// \param[in] imagePath Путь к изображению.
+        /// \param[in,out] image Изображение, переданное в `load`.
+        /// \param[in] alphas Перебираемые пороги.
+        /// \param[in] deltas Перебираемые радиусы.
+        std::vector<AnalysisResult> analyzeSweepLoaded(const std::string& imagePath, LoadedImage& image, const std::vector<Real>& alphas, const std::vector<Real>& deltas) const;
+
+        /// \brief Сохраняет результаты перебора параметров в таблицу `sweep_summary.csv`.
+        /// \param[in] results Результаты, по одной строке на (изображение, alpha, delta).
+        /// \param[in] output_path Папка для сохранения.
+        void saveSweepSummary(const std::vector<AnalysisResult>& results, const std::string& output_path) const;
+
+        /// \brief Сохраняет карты локальных признаков LGLE и DN из результата анализа в 32-битные TIFF.
+        /// \param[in] result Результат `analyze`, вычисленный с заданным `setFeatureMapWindow`.
+        /// \param[in] output_path Папка для сохранения карт.
+        void saveFeatureMaps(const AnalysisResult& result, const std::string& output_path) const;
+
+        /// \brief Задаёт сторону окна для карт локальных признаков, вычисляемых в `analyze`.
+        /// \param[in] windowSize Сторона окна (нечётная), 0 - карты не вычисляются.
+        void setFeatureMapWindow(int windowSize);
+
+        /// \brief Включает сохранение декодированного изображения в результате анализа (нужно GUI).
+        /// \param[in] keep `true`, чтобы результат держал изображение.
+        void setKeepImages(bool keep);
+
+        /// \brief Подключает кэш матриц.
+        /// \param[in] matrixCache Кэш, общий для всех потоков анализа.
+        /// \param[in] mode Способ использования кэша.
+        void setCache(std::shared_ptr<GLDMCache> matrixCache, CacheMode mode);
+
+         /// \brief Устанавливает число потоков для вычисления GLDM одного изображения.
+         /// \param[in] threads Число потоков (0 - все ядра).
+        void setThreads(int threads);
+
+         /// \brief Включает построчное чтение изображений с ограниченным потреблением памяти.
+         ///
+         /// Форматы без построчного чтения по-прежнему декодируются целиком.
+         /// \param[in] streaming `true`, чтобы читать изображения полосами.
+        void setStreaming(bool streaming);
+
+         /// \brief Устанавливает число уровней серого и способ квантования для всех изображений.
+         /// \param[in] levels Параметры квантования.
+         /// \return `false`, если параметры некорректны.
+        bool setQuantization(const GLDMQuantization& levels);
+
+        /// \brief Текущие параметры квантования.
+        [[nodiscard]] const GLDMQuantization& getQuantization() const { return quantization; }
+
+        /// \brief Включает быстрое приближённое декодирование в уменьшенном разрешении.
+        ///
+        /// Построчное чтение (`setStreaming`) при уменьшении не используется. GLN и DN приводятся
+        /// к полному разрешению (`scaleToFullResolution`).
+        /// \param[in] reduction Во сколько раз уменьшать стороны изображения: 1, 2, 4 или 8.
+        /// \return `false`, если значение не поддерживается.
+        bool setDecodeReduction(int reduction);
+
+        /// \brief Определяет категорию текстуры по значениям LGLE и DN.
+        static std::string classify(double LGLE, double DN);
+
+        /// \brief Приводит признаки, зависящие от числа пикселей (GLN, DN), к полному разрешению.
+        ///
+        /// При уменьшении сторон в N раз пикселей в N^2 раз меньше, и без поправки порог `classify`
+        /// по DN относил бы почти все текстуры к однородным.
+        /// \param[in] features Признаки изображения, декодированного с уменьшением.
+        /// \param[in] reduction Во сколько раз уменьшены стороны (`setDecodeReduction`).
+        static GLDMFeatureSet scaleToFullResolution(GLDMFeatureSet features, int reduction);
     private:
+        /// \brief Проверяет, что изображения читаются построчно.
+        bool isStreamingRead() const;
+
+        /// \brief Ключ кэша изображения для заданных параметров.
+        GLDMCacheKey cacheKey(const LoadedImage& image, Real delta, Real alpha) const;
+
+        /// \brief Вычисляет матрицу изображения выбранным способом (целиком или построчно).
+        /// \param[in] imagePath Путь к изображению.
+        /// \param[out] gldm Объект с вычисленной матрицей.
+        /// \return `false`, если изображение не удалось прочитать.
+        bool computeMatrix(const std::string& imagePath, GLDM& gldm) const;
+
         /// \brief Сохраняет результаты анализа в txt.
         /// \param[in] originalName Имя изображеения.
         /// \param[in] output_path Расположение выходного файла.
-        /// \param[in] LGLE Значение признака LGLE.
-        /// \param[in] DN Значение признака DN.
-        void saveSummaryToFile(const std::string& originalName, const std::string& output_path, misis::Real LGLE, misis::Real DN);
+        /// \param[in] features Полный набор признаков GLDM.
+        void saveSummaryToFile(const std::string& originalName, const std::string& output_path, const GLDMFeatureSet& features) const;
         
         Real alpha;
         Real delta;
+        int threads = 1;
+        bool streaming = false; ///< Читать изображения построчно.
+        int decodeReduction = 1; ///< Уменьшение сторон при декодировании.
+        GLDMQuantization quantization; ///< Параметры квантования уровней серого.
+        int featureMapWindow = 0; ///< Сторона окна карт признаков, 0 - карты не нужны.
+        bool keepImages = false; ///< Сохранять изображение в `AnalysisResult`.
+        std::shared_ptr<GLDMCache> cache; ///< Кэш матриц.
+        CacheMode cacheMode = CacheMode::Off; ///< Способ использования кэша.
+        GLDMKernel kernel = GLDMKernel::Auto; ///< Ядро, выбранное в `setParams`.
     };
 }
 
@@ -0,0 +1,145 @@
+#include "featuremaps.hpp"
+#include "gldm.hpp"
+#include <algorithm>
+#include <vector>
+
+using namespace misis;
+
+namespace
+{
+    /// \brief Гистограмма окна вместе с суммой квадратов её счётчиков.
+    struct WindowHistogram
+    {
+        std::vector<uint32_t> bins;
+        uint64_t squares = 0; ///< Сумма квадратов счётчиков.
+        uint64_t total = 0; ///< Сумма счётчиков.
+
+        void reset()
+        {
+            std::fill(bins.begin(), bins.end(), 0);
+            squares = 0;
+            total = 0;
+        }
+
+        void addColumn(const uint32_t* column)
+        {
+            for (size_t b = 0; b < bins.size(); ++b) {
+                const uint64_t v = column[b];
+                if (v == 0) continue;
+                squares += 2 * bins[b] * v + v * v;
+                bins[b] += static_cast<uint32_t>(v);
+                total += v;
+            }
+        }
+
+        void removeColumn(const uint32_t* column)
+        {
+            for (size_t b = 0; b < bins.size(); ++b) {
+                const uint64_t v = column[b];
+                if (v == 0) continue;
+                squares -= 2 * bins[b] * v - v * v;
+                bins[b] -= static_cast<uint32_t>(v);
+                total -= v;
+            }
+        }
+    };
+
+    /// \brief Прибавляет (`sign = 1`) или вычитает (`sign = -1`) строку карты зависимостей из гистограмм столбцов,
+    /// а веса LGLE её учитываемых пикселей - из сумм весов столбцов.
+    template <typename Level>
+    void updateColumns(const cv::Mat& gray, const cv::Mat& dependence, int y, int maxDependence, int sign,
+        std::vector<uint32_t>& columns, std::vector<double>& columnWeights)
+    {
+        const Level* g = gray.ptr<Level>(y);
+        const int* row = dependence.ptr<int>(y);
+        const size_t bins = static_cast<size_t>(maxDependence) + 1;
+        for (int x = 0; x < dependence.cols; ++x) {
+            if (row[x] <= maxDependence) {
+                columns[x * bins + row[x]] += sign;
+                columnWeights[x] += sign / ((g[x] + 1.0) * (g[x] + 1.0));
+            }
+        }
+    }
+}
+
+GLDMFeatureMaps misis::computeFeatureMaps(const cv::Mat& gray, const cv::Mat& dependence, int maxDependence, int windowSize, int threads)
+{
+    GLDMFeatureMaps maps;
+    CheckReturn((gray.type() == CV_8UC1 || gray.type() == CV_16UC1) && dependence.type() == CV_32SC1 && gray.size() == dependence.size(), maps);
+    CheckReturn(windowSize > 0 && windowSize % 2 == 1 && maxDependence >= 0, maps);
+
+    const int rows = gray.rows;
+    const int cols = gray.cols;
+    const int half = windowSize / 2;
+    const size_t bins = static_cast<size_t>(maxDependence) + 1;
+
+    maps.LGLE.create(rows, cols, CV_32FC1);
+    maps.DN.create(rows, cols, CV_32FC1);
+
+    if (threads <= 0)
+        threads = cv::getNumberOfCPUs();
+    const int bands = std::max(1, std::min(threads, rows));
+
+    cv::parallel_for_(cv::Range(0, bands), [&](const cv::Range& range) {
+        // LGLE is a plain window mean of 1/(i+1)^2 over the counted pixels, so its window sum slides
+        // with the histograms: per-column sums over the window rows, then a running sum along the row.
+        std::vector<uint32_t> columns(static_cast<size_t>(cols) * bins);
+        std::vector<double> columnWeights(cols);
+        WindowHistogram window;
+        window.bins.resize(bins);
+        const auto update = [&](int y, int sign) {
+            if (gray.depth() == CV_8U)
+                updateColumns<uchar>(gray, dependence, y, maxDependence, sign, columns, columnWeights);
+            else
+                updateColumns<ushort>(gray, dependence, y, maxDependence, sign, columns, columnWeights);
+        };
+
+        for (int band = range.start; band < range.end; ++band) {
+            const int yBegin = static_cast<int>(static_cast<int64_t>(rows) * band / bands);
+            const int yEnd = static_cast<int>(static_cast<int64_t>(rows) * (band + 1) / bands);
+            if (yBegin >= yEnd) continue;
+
+            std::fill(columns.begin(), columns.end(), 0);
+            std::fill(columnWeights.begin(), columnWeights.end(), 0.0);
+            for (int y = std::max(yBegin - half, 0); y <= std::min(yBegin + half, rows - 1); ++y)
+                update(y, 1);
+
+            for (int y = yBegin; y < yEnd; ++y) {
+                if (y > yBegin) {
+                    if (y - half - 1 >= 0)
+                        update(y - half - 1, -1);
+                    if (y + half < rows)
+                        update(y + half, 1);
+                }
+
+                window.reset();
+                double weightSum = 0.0;
+                for (int x = 0; x <= std::min(half, cols - 1); ++x) {
+                    window.addColumn(columns.data() + x * bins);
+                    weightSum += columnWeights[x];
+                }
+
+                float* lgle = maps.LGLE.ptr<float>(y);
+                float* dn = maps.DN.ptr<float>(y);
+                for (int x = 0; x < cols; ++x) {
+                    if (x > 0) {
+                        if (x + half < cols) {
+                            window.addColumn(columns.data() + (x + half) * bins);
+                            weightSum += columnWeights[x + half];
+                        }
+                        if (x - half - 1 >= 0) {
+                            window.removeColumn(columns.data() + (x - half - 1) * bins);
+                            weightSum -= columnWeights[x - half - 1];
+                        }
+                    }
+
+                    const double Nz = static_cast<double>(window.total);
+                    lgle[x] = Nz > 0 ? static_cast<float>(weightSum / Nz) : 0.0f;
+                    dn[x] = Nz > 0 ? static_cast<float>(window.squares / Nz) : 0.0f;
+                }
+            }
+        }
+    }, bands);
+
+    return maps;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#ifndef GLDMFeatureMaps_2025
+#define GLDMFeatureMaps_2025
+
+#include <opencv2/core.hpp>
+
+namespace misis
+{
+    /// \brief Карты локальных признаков GLDM.
+    ///
+    /// Значение в пикселе - признак GLDM, посчитанный по окну W x W с центром в этом пикселе.
+    /// У границ окно обрезается изображением.
+    struct GLDMFeatureMaps
+    {
+        cv::Mat LGLE; ///< Карта Low Gray Level Emphasis, `CV_32F`.
+        cv::Mat DN; ///< Карта Dependence Non-Uniformity, `CV_32F`.
+    };
+
+    /// \brief Вычисляет карты локальных признаков по карте числа зависимых соседей.
+    ///
+    /// LGLE линеен по пикселям и считается оконным фильтром. Для DN поддерживаются гистограммы
+    /// столбцов высотой W (метод Perreault): при сдвиге окна на пиксель добавляется одна гистограмма
+    /// столбца и удаляется другая, а сумма квадратов счётчиков обновляется за O(число столбцов GLDM),
+    /// независимо от W.
+    /// \param[in] gray Уровни серого, `CV_8U` или `CV_16U` (см. `GLDM::computeLevelImage`).
+    /// \param[in] dependence Число зависимых соседей каждого пикселя, `CV_32S` (см. `GLDM::computeDependenceMap`).
+    /// \param[in] maxDependence Максимальное число зависимых соседей; пиксели с большим числом не учитываются.
+    /// \param[in] windowSize Сторона окна W (нечётная).
+    /// \param[in] threads Число потоков (0 - все ядра).
+    GLDMFeatureMaps computeFeatureMaps(const cv::Mat& gray, const cv::Mat& dependence, int maxDependence, int windowSize, int threads = 1);
+}
+
+#endif
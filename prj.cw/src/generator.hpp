@@ -1,75 +1,127 @@
 #include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 /// \brief Генератор тестовых изображений для анализа GLDM.
 /// 
 /// Класс позволяет генерировать разные синтетические изображения для анализа и дебага.
+/// Все изображения 8-битные, а случайные значения берутся из собственного генератора
+/// экземпляра, поэтому одинаковое зерно всегда даёт одинаковые изображения, а разные
+/// экземпляры можно использовать из разных потоков.
 class GLDMFeatureImageGenerator {
 public:
+    /// \brief Число видов изображений, см. `generate`.
+    static constexpr int patternCount = 6;
+
+    /// \brief Имена видов изображений в порядке номеров `generate`.
+    static constexpr const char* patternNames[patternCount] = {
+        "low_gray", "uniform_dep", "nonuniform_dep", "noise", "gradient", "spot"
+    };
+
     /// \brief Конструктор генератора с заданными размерами.
     /// \param[in] width Ширина генерируемых изображений.
     /// \param[in] height Высота генерируемых изображений.
-    GLDMFeatureImageGenerator(int width = 1024, int height = 512)
-        : width(width), height(height) {}
+    /// \param[in] seed Зерно генератора случайных чисел.
+    GLDMFeatureImageGenerator(int width = 1024, int height = 512, uint64_t seed = 2025)
+        : width(width), height(height), rng(seed) {}
+
+    /// \brief Зерно изображения с номером `index` в наборе с зерном `seed`.
+    ///
+    /// Зерна соседних изображений не связаны между собой (перемешивание SplitMix64),
+    /// поэтому изображение можно получить по номеру, не генерируя предыдущие.
+    static uint64_t imageSeed(uint64_t seed, uint64_t index) {
+        uint64_t z = seed + (index + 1) * 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    /// \brief Генерирует изображение вида `pattern` (номер в `patternNames`).
+    cv::Mat generate(int pattern) {
+        switch (pattern) {
+        case 0: return generateLowGrayLevelImage();
+        case 1: return generateHighDependenceUniformityImage();
+        case 2: return generateHighDependenceNonUniformityImage();
+        case 3: return generateRandomNoiseImage();
+        case 4: return generateGradientImage();
+        default: return generateSpotImage();
+        }
+    }
 
     /// \brief Генерирует изображение с низким уровнем серого.
     cv::Mat generateLowGrayLevelImage() {
-        cv::Mat img(height, width, CV_64F);
-        cv::randu(img, cv::Scalar(0), cv::Scalar(50));
+        cv::Mat img(height, width, CV_8UC1);
+        rng.fill(img, cv::RNG::UNIFORM, cv::Scalar(0), cv::Scalar(50));
         return img;
     }
 
     /// \brief Генерирует изображение с высокой однородностью.
     cv::Mat generateHighDependenceUniformityImage() {
-        cv::Mat img(height, width, CV_64F, cv::Scalar(0));
-        int blockSize = 16;
+        cv::Mat img(height, width, CV_8UC1);
+        const int blockSize = 16;
+        std::vector<uchar> row(width);
         for (int y = 0; y < height; y += blockSize) {
-            for (int x = 0; x < width; x += blockSize) {
-                uchar val = (rand() % 4) * 50; 
-                cv::Rect roi(x, y, blockSize, blockSize);
-                img(roi) = val;
-            }
+            // One row of block values is built per band and then copied into each of its rows.
+            for (int x = 0; x < width; x += blockSize)
+                std::fill_n(row.begin() + x, std::min(blockSize, width - x), static_cast<uchar>(rng.uniform(0, 4) * 50));
+            for (int by = y; by < std::min(y + blockSize, height); ++by)
+                std::copy(row.begin(), row.end(), img.ptr<uchar>(by));
         }
         return img;
     }
 
     /// \brief Генерирует изображение с низкой однородностью.
+    ///
+    /// Каждый блок 16x16 - шум со своим случайным средним уровнем.
     cv::Mat generateHighDependenceNonUniformityImage() {
-        cv::Mat img(height, width, CV_64F);
-        for (int y = 0; y < height; y += 16) {
-            for (int x = 0; x < width; x += 16) {
-                cv::Mat block(16, 16, CV_8UC1);
-                cv::randu(block, cv::Scalar(0), cv::Scalar(255));
-                block.copyTo(img(cv::Rect(x, y, 16, 16)));
+        cv::Mat img(height, width, CV_8UC1);
+        rng.fill(img, cv::RNG::UNIFORM, cv::Scalar(0), cv::Scalar(64));
+        const int blockSize = 16;
+        std::vector<uchar> offsets(width);
+        for (int y = 0; y < height; y += blockSize) {
+            for (int x = 0; x < width; x += blockSize)
+                std::fill_n(offsets.begin() + x, std::min(blockSize, width - x), static_cast<uchar>(rng.uniform(0, 192)));
+            for (int by = y; by < std::min(y + blockSize, height); ++by) {
+                uchar* out = img.ptr<uchar>(by);
+                for (int x = 0; x < width; ++x)
+                    out[x] += offsets[x];
             }
         }
         return img;
     }
 
     /// \brief Генерирует градиентное изображение слева направо.
+    ///
+    /// Градиент начинается со случайного уровня от 0 до 63 и доходит до 255.
     cv::Mat generateGradientImage() {
         cv::Mat img(height, width, CV_8UC1);
-        for (int y = 0; y < height; ++y) {
-            for (int x = 0; x < width; ++x) {
-                img.at<uchar>(y, x) = static_cast<uchar>((255.0 * x) / width);
-            }
-        }
+        const int low = rng.uniform(0, 64);
+        uchar* first = img.ptr<uchar>(0);
+        for (int x = 0; x < width; ++x)
+            first[x] = static_cast<uchar>(low + ((255.0 - low) * x) / width);
+        for (int y = 1; y < height; ++y)
+            std::copy(first, first + width, img.ptr<uchar>(y));
         return img;
     }
 
-    /// \brief Генерирует изображение с кругом в центре.
+    /// \brief Генерирует изображение с кругом около центра.
+    ///
+    /// Центр смещается на случайную величину до 1/16 размера изображения.
     cv::Mat generateSpotImage() {
         cv::Mat img(height, width, CV_8UC1, cv::Scalar(0));
-        cv::Point center(width / 2, height / 2);
-        int radius = min(width, height) / 4;
+        cv::Point center(width / 2 + rng.uniform(-width / 16, width / 16 + 1),
+            height / 2 + rng.uniform(-height / 16, height / 16 + 1));
+        int radius = std::min(width, height) / 4;
         circle(img, center, radius, cv::Scalar(200), -1);  
         return img;
     }
 
     /// \brief Генерирует изображение со случайным шумом.
     cv::Mat generateRandomNoiseImage() {
-        cv::Mat img(height, width, CV_64F);
-        cv::randu(img, cv::Scalar(0), cv::Scalar(255));
+        cv::Mat img(height, width, CV_8UC1);
+        rng.fill(img, cv::RNG::UNIFORM, cv::Scalar(0), cv::Scalar(255));
         return img;
     }
 
@@ -83,4 +135,5 @@ public:
 private:
     int width; ///< Ширина генерируемых изображений.
     int height; ///< Высота генерируемых изображений.
+    cv::RNG rng; ///< Генератор случайных чисел экземпляра.
 };
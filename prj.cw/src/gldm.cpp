@@ -1,22 +1,412 @@
 #include "gldm.hpp"
+#include "imageinput.hpp"
+#include "kernels.hpp"
+#include "profiler.hpp"
+#include "rowsource.hpp"
+#include <functional>
 #include <numeric>
 using namespace misis;
 
+namespace
+{
+    /// \brief Строит таблицу перевода значений пикселей в уровни серого матрицы.
+    /// \param[in] quantization Параметры квантования.
+    /// \param[in] depth Глубина изображения, `CV_8U` или `CV_16U`.
+    template <typename Level>
+    std::vector<Level> makeLevelTable(const GLDMQuantization& quantization, int depth)
+    {
+        const int inputLevels = depth == CV_16U ? 65536 : 256;
+        std::vector<Level> table(inputLevels);
+        for (int value = 0; value < inputLevels; ++value) {
+            const int64_t level = quantization.mode == QuantizationMode::Linear
+                ? static_cast<int64_t>(value) * quantization.grayLevels / inputLevels
+                : value / quantization.binWidth;
+            table[value] = static_cast<Level>(std::min<int64_t>(level, quantization.grayLevels - 1));
+        }
+        return table;
+    }
+
+    /// \brief Проверяет, что квантование не меняет значения и строки изображения можно читать напрямую.
+    template <typename Level>
+    bool isIdentityTable(const std::vector<Level>& table, int depth)
+    {
+        if (static_cast<int>(sizeof(Level)) != CV_ELEM_SIZE1(depth))
+            return false;
+        for (size_t value = 0; value < table.size(); ++value) {
+            if (table[value] != value)
+                return false;
+        }
+        return true;
+    }
+
+    /// \brief Переводит строку пикселей глубины `depth` в уровни серого.
+    template <typename Level>
+    void quantizeRow(const uchar* source, int depth, int cols, const std::vector<Level>& table, Level* levels)
+    {
+        if (depth == CV_16U) {
+            const ushort* pixels = reinterpret_cast<const ushort*>(source);
+            for (int x = 0; x < cols; ++x)
+                levels[x] = table[pixels[x]];
+        }
+        else {
+            for (int x = 0; x < cols; ++x)
+                levels[x] = table[source[x]];
+        }
+    }
+
+    /// \brief Скользящее окно из `2r + 1` строк уровней серого вокруг текущей строки.
+    ///
+    /// Каждая строка квантуется один раз, когда входит в окно, и хранится в кольцевом буфере:
+    /// строка `y` лежит в ячейке `y % window`. Если квантование тождественное, окно указывает
+    /// прямо на строки изображения и ничего не копирует.
+    template <typename Level>
+    class LevelWindow
+    {
+    public:
+        /// \brief Загружает строку `y` в буфер уровней размера `cols`. Строки запрашиваются по возрастанию.
+        using Loader = std::function<bool(int y, Level* levels)>;
+
+        /// \brief Окно над изображением в памяти.
+        LevelWindow(const cv::Mat& image, const std::vector<Level>& table, int radius)
+            : LevelWindow(image.rows, image.cols, radius, nullptr)
+        {
+            if (isIdentityTable(table, image.depth())) {
+                direct = &image;
+                return;
+            }
+            load = [&image, &table](int y, Level* levels) {
+                quantizeRow(image.ptr<uchar>(y), image.depth(), image.cols, table, levels);
+                return true;
+            };
+        }
+
+        /// \brief Окно над произвольным построчным источником.
+        LevelWindow(int rows, int cols, int radius, Loader loader)
+            : load(std::move(loader))
+            , rowCount(rows)
+            , colCount(cols)
+            , radius(radius)
+            , window(std::min(2 * radius + 1, std::max(rows, 1)))
+            , pointers(2 * radius + 1)
+        {
+        }
+
+        /// \brief Сдвигает окно на строку `y`: подгружает строки до `y + r`.
+        /// \param[in] y Номер строки; при каждом вызове не меньше предыдущего.
+        /// \return `false`, если источник не смог отдать строку.
+        bool moveTo(int y)
+        {
+            if (direct) {
+                for (int k = 0; k <= 2 * radius; ++k) {
+                    const int ny = y + k - radius;
+                    pointers[k] = (ny >= 0 && ny < rowCount) ? direct->ptr<Level>(ny) : nullptr;
+                }
+                return true;
+            }
+
+            if (ring.empty()) {
+                ring.resize(static_cast<size_t>(window) * colCount);
+                next = std::max(0, y - radius);
+            }
+            for (; next <= std::min(y + radius, rowCount - 1); ++next) {
+                if (!load(next, ring.data() + static_cast<size_t>(next % window) * colCount))
+                    return false;
+            }
+            for (int k = 0; k <= 2 * radius; ++k) {
+                const int ny = y + k - radius;
+                pointers[k] = (ny >= 0 && ny < rowCount) ? ring.data() + static_cast<size_t>(ny % window) * colCount : nullptr;
+            }
+            return true;
+        }
+
+        /// \brief Указатели на строки `y - r ... y + r`, `nullptr` за границей изображения.
+        [[nodiscard]] const Level* const* rows() const { return pointers.data(); }
+
+    private:
+        Loader load; ///< Источник строк, если окно не читает изображение напрямую.
+        const cv::Mat* direct = nullptr; ///< Изображение, строки которого уже являются уровнями серого.
+        int rowCount = 0; ///< Высота изображения.
+        int colCount = 0; ///< Ширина изображения.
+        int radius = 0; ///< Радиус окна.
+        int window = 1; ///< Число ячеек кольцевого буфера.
+        int next = 0; ///< Следующая строка для загрузки.
+        std::vector<Level> ring; ///< Кольцевой буфер квантованных строк.
+        std::vector<const Level*> pointers; ///< Текущие указатели на строки окна.
+    };
+
+    /// \brief Добавляет в матрицу одну строку изображения.
+    /// \param[in] rows Указатели на строки `y - r ... y + r`, `nullptr` за границей изображения.
+    /// \param[in] counts Рабочий буфер размера `cols`.
+    template <typename Level>
+    void accumulateRow(const Level* const* rows, int cols, const kernels::Neighbourhood& hood,
+        kernels::RowKernel<Level> countRow, int* counts, GLDMMatrix& partial)
+    {
+        const int maxDependence = partial.maxDependence();
+        uint32_t* histogram = partial.data();
+
+        countRow(rows, cols, hood, counts);
+
+        const Level* center = rows[hood.radius];
+        for (int x = 0; x < cols; ++x) {
+            if (counts[x] <= maxDependence)
+                histogram[static_cast<size_t>(center[x]) * (maxDependence + 1) + counts[x]]++;
+        }
+    }
+
+    /// \brief Накапливает гистограмму зависимостей для строк `[yBegin, yEnd)`.
+    ///
+    /// Строки полосы читаются вместе с ореолом из `radius` строк сверху и снизу,
+    /// поэтому результат для полосы не зависит от того, как разбито изображение.
+    template <typename Level>
+    void accumulateBand(const cv::Mat& image, const std::vector<Level>& table, int yBegin, int yEnd,
+        const kernels::Neighbourhood& hood, kernels::RowKernel<Level> countRow, GLDMMatrix& partial)
+    {
+        LevelWindow<Level> window(image, table, hood.radius);
+        std::vector<int> counts(image.cols);
+
+        for (int y = yBegin; y < yEnd; ++y) {
+            window.moveTo(y);
+            accumulateRow(window.rows(), image.cols, hood, countRow, counts.data(), partial);
+        }
+    }
+
+    /// \brief Возвращает построчное ядро, соответствующее выбранной реализации и радиусу окна.
+    template <typename Level>
+    kernels::RowKernel<Level> resolveRowKernel(GLDMKernel kernel, const kernels::Neighbourhood& hood, Real alpha)
+    {
+        if (kernel == GLDMKernel::Auto)
+            kernel = GLDM::selectKernel(static_cast<Real>(hood.radius), alpha);
+        if (kernel == GLDMKernel::Specialized && !kernels::specializedRowKernel<Level>(hood.radius))
+            kernel = GLDMKernel::Simd;
+        if (kernel == GLDMKernel::Simd && !kernels::isSimdAvailable(hood.radius))
+            kernel = GLDMKernel::Scalar;
+
+        if (kernel == GLDMKernel::Simd)
+            return &kernels::countRowSimd<Level>;
+        if (kernel == GLDMKernel::Specialized)
+            return kernels::specializedRowKernel<Level>(hood.radius);
+        return &kernels::countRowScalar<Level>;
+    }
+
+    /// \brief Делит изображение на `threads` полос и вызывает `body(yBegin, yEnd, band)` для каждой.
+    /// \return Число полос.
+    template <typename Body>
+    int forEachBand(int rows, int threads, Body&& body)
+    {
+        if (threads <= 0)
+            threads = cv::getNumberOfCPUs();
+        const int bands = std::max(1, std::min(threads, rows));
+        cv::parallel_for_(cv::Range(0, bands), [&](const cv::Range& range) {
+            for (int band = range.start; band < range.end; ++band) {
+                const int yBegin = static_cast<int>(static_cast<int64_t>(rows) * band / bands);
+                const int yEnd = static_cast<int>(static_cast<int64_t>(rows) * (band + 1) / bands);
+                body(yBegin, yEnd, band);
+            }
+        }, bands);
+        return bands;
+    }
 
+    /// \brief Число ячеек матрицы `Ng x (maxDependence + 1)`.
+    size_t matrixCells(const GLDMQuantization& quantization, int maxDependence)
+    {
+        return static_cast<size_t>(quantization.grayLevels) * (static_cast<size_t>(maxDependence) + 1);
+    }
+
+    /// \brief Вычисляет матрицу для изображения в памяти.
+    /// \param[out] result Матрица; её память используется повторно, если размер не изменился.
+    template <typename Level>
+    bool accumulateMatrix(const cv::Mat& image, const GLDMQuantization& quantization,
+        const kernels::Neighbourhood& hood, kernels::RowKernel<Level> countRow, int threads, GLDMMatrix& result)
+    {
+        const std::vector<Level> table = makeLevelTable<Level>(quantization, image.depth());
+        const int maxDependence = GLDMMatrix::maxDependenceForRadius(hood.radius, image.rows, image.cols);
+        const size_t cells = matrixCells(quantization, maxDependence);
+        CheckReturn(cells <= GLDMMatrix::maxCells, false);
+
+        // Each band owns a private matrix, so workers never share a counter; the first band counts straight into the result.
+        // Partials are summed in band order afterwards, which keeps the result exact for any thread count.
+        const int bandCount = GLDM::partialBands(threads, image.rows, cells);
+        result.reset(quantization.grayLevels, maxDependence);
+        std::vector<GLDMMatrix> partials(bandCount - 1, GLDMMatrix(quantization.grayLevels, maxDependence));
+        forEachBand(image.rows, bandCount, [&](int yBegin, int yEnd, int band) {
+            accumulateBand(image, table, yBegin, yEnd, hood, countRow, band == 0 ? result : partials[band - 1]);
+        });
+
+        for (const GLDMMatrix& partial : partials)
+            result.merge(partial);
+        result.updateMarginals();
+        return true;
+    }
+
+    /// \brief Проверяет изображение и вычисляет матрицу в `result`.
+    bool computeMatrixInto(const cv::Mat& view, Real delta, Real alpha, const GLDMQuantization& quantization,
+        GLDMKernel kernel, int threads, GLDMMatrix& result)
+    {
+        CheckReturn(!view.empty() && (view.type() == CV_8UC1 || view.type() == CV_16UC1), false);
+        CheckReturn(view.total() <= GLDMMatrix::maxPixels, false);
+        CheckReturn(GLDM::isValidQuantization(quantization), false);
+        GLDM_PROFILE_SCOPE("GLDM::computeMatrix");
+        GLDM_PROFILE_PIXELS(view.total());
+
+        const kernels::Neighbourhood hood = kernels::makeNeighbourhood(delta, alpha, std::max(view.rows, view.cols));
+        if (quantization.grayLevels <= 256)
+            return accumulateMatrix<uchar>(view, quantization, hood, resolveRowKernel<uchar>(kernel, hood, alpha), threads, result);
+        return accumulateMatrix<ushort>(view, quantization, hood, resolveRowKernel<ushort>(kernel, hood, alpha), threads, result);
+    }
+
+    /// \brief Вычисляет карту числа зависимых соседей.
+    template <typename Level>
+    cv::Mat computeDependence(const cv::Mat& image, const GLDMQuantization& quantization,
+        const kernels::Neighbourhood& hood, Real alpha, int threads)
+    {
+        const std::vector<Level> table = makeLevelTable<Level>(quantization, image.depth());
+        const kernels::RowKernel<Level> countRow = resolveRowKernel<Level>(GLDMKernel::Auto, hood, alpha);
+        // From radius 128 a pixel can have more than 65535 neighbours, so the counts are stored as int.
+        cv::Mat dependence(image.rows, image.cols, CV_32SC1);
+
+        forEachBand(image.rows, threads, [&](int yBegin, int yEnd, int) {
+            LevelWindow<Level> window(image, table, hood.radius);
+            for (int y = yBegin; y < yEnd; ++y) {
+                window.moveTo(y);
+                countRow(window.rows(), image.cols, hood, dependence.ptr<int>(y));
+            }
+        });
+        return dependence;
+    }
+
+    /// \brief Вычисляет матрицу, читая изображение из построчного источника.
+    template <typename Level>
+    bool computeMatrixStreaming(RowSource& source, const GLDMQuantization& quantization,
+        const kernels::Neighbourhood& hood, kernels::RowKernel<Level> countRow, GLDMMatrix& result)
+    {
+        const int cols = source.cols();
+        const int depth = source.depth();
+        const std::vector<Level> table = makeLevelTable<Level>(quantization, depth);
+
+        // Only the 2 * delta + 1 quantized rows around the current one are resident; raw pixels pass through one scratch row.
+        std::vector<uchar> scratch(static_cast<size_t>(cols) * CV_ELEM_SIZE1(depth));
+        LevelWindow<Level> window(source.rows(), cols, hood.radius, [&](int, Level* levels) {
+            if (!source.readRow(scratch.data()))
+                return false;
+            quantizeRow(scratch.data(), depth, cols, table, levels);
+            return true;
+        });
+        std::vector<int> counts(cols);
+        // Every pixel may land in the same cell, and the counts are 32-bit.
+        CheckReturn(static_cast<uint64_t>(source.rows()) * cols <= GLDMMatrix::maxPixels, false);
+        const int maxDependence = GLDMMatrix::maxDependenceForRadius(hood.radius, source.rows(), cols);
+        CheckReturn(matrixCells(quantization, maxDependence) <= GLDMMatrix::maxCells, false);
+        result = GLDMMatrix(quantization.grayLevels, maxDependence);
+
+        for (int y = 0; y < source.rows(); ++y) {
+            CheckReturn(window.moveTo(y), false);
+            accumulateRow(window.rows(), cols, hood, countRow, counts.data(), result);
+        }
+        result.updateMarginals();
+        return true;
+    }
+
+    /// \brief Накапливает матрицы всех пар (alpha, delta) для строк `[yBegin, yEnd)` за один обход.
+    template <typename Level>
+    void accumulateSweepBand(const cv::Mat& image, const std::vector<Level>& table, int yBegin, int yEnd,
+        const std::vector<int>& thresholds, const std::vector<int>& radii, std::vector<GLDMMatrix>& partials)
+    {
+        const int R = *std::max_element(radii.begin(), radii.end());
+        LevelWindow<Level> window(image, table, R);
+        std::vector<int> counts(partials.size() * image.cols);
+
+        for (int y = yBegin; y < yEnd; ++y) {
+            window.moveTo(y);
+            const Level* const* rows = window.rows();
+            kernels::countRowSweep(rows, image.cols, thresholds, radii, counts.data());
+
+            const Level* center = rows[R];
+            for (size_t cell = 0; cell < partials.size(); ++cell) {
+                const int* cellCounts = counts.data() + cell * image.cols;
+                const int maxDependence = partials[cell].maxDependence();
+                uint32_t* histogram = partials[cell].data();
+                for (int x = 0; x < image.cols; ++x) {
+                    if (cellCounts[x] <= maxDependence)
+                        histogram[static_cast<size_t>(center[x]) * (maxDependence + 1) + cellCounts[x]]++;
+                }
+            }
+        }
+    }
 
-GLDM::GLDM(const std::filesystem::path& img, const Real alpha, const Real delta)
+    /// \brief Вычисляет матрицы всех пар (alpha, delta).
+    template <typename Level>
+    std::vector<GLDMMatrix> computeSweepMatrices(const cv::Mat& image, const GLDMQuantization& quantization,
+        const std::vector<int>& thresholds, const std::vector<int>& radii, int threads)
+    {
+        const std::vector<Level> table = makeLevelTable<Level>(quantization, image.depth());
+        CheckReturn(image.total() <= GLDMMatrix::maxPixels, {});
+
+        size_t cells = 0;
+        for (const int radius : radii)
+            cells += matrixCells(quantization, GLDMMatrix::maxDependenceForRadius(radius, image.rows, image.cols));
+        CheckReturn(cells * thresholds.size() <= GLDMMatrix::maxCells, {});
+
+        std::vector<GLDMMatrix> empty;
+        for (size_t a = 0; a < thresholds.size(); ++a)
+            for (const int radius : radii)
+                empty.emplace_back(quantization.grayLevels, GLDMMatrix::maxDependenceForRadius(radius, image.rows, image.cols));
+
+        const int bandCount = GLDM::partialBands(threads, image.rows, cells * thresholds.size());
+        std::vector<std::vector<GLDMMatrix>> partials(bandCount, empty);
+        forEachBand(image.rows, bandCount, [&](int yBegin, int yEnd, int band) {
+            accumulateSweepBand(image, table, yBegin, yEnd, thresholds, radii, partials[band]);
+        });
+
+        std::vector<GLDMMatrix> matrices = std::move(partials[0]);
+        for (size_t cell = 0; cell < matrices.size(); ++cell) {
+            for (int band = 1; band < bandCount; ++band)
+                matrices[cell].merge(partials[band][cell]);
+            matrices[cell].updateMarginals();
+        }
+        return matrices;
+    }
+
+    /// \brief Флаги `cv::imread` для чтения в оттенках серого с уменьшением `reduction` (1, 2, 4 или 8).
+    bool decodeFlags(int reduction, int& flags)
+    {
+        switch (reduction) {
+        // ANYDEPTH keeps 16-bit images as CV_16U instead of truncating them to 8 bits.
+        case 1: flags = cv::IMREAD_GRAYSCALE | cv::IMREAD_ANYDEPTH; return true;
+        case 2: flags = cv::IMREAD_REDUCED_GRAYSCALE_2; return true;
+        case 4: flags = cv::IMREAD_REDUCED_GRAYSCALE_4; return true;
+        case 8: flags = cv::IMREAD_REDUCED_GRAYSCALE_8; return true;
+        default: return false;
+        }
+    }
+
+    /// \brief Приводит изображение к одноканальному `CV_8U` или `CV_16U`.
+    cv::Mat toGrayLevels(const cv::Mat& mat)
+    {
+        cv::Mat gray = mat;
+        if (gray.channels() == 3)
+            cv::cvtColor(gray, gray, cv::COLOR_BGR2GRAY);
+        else if (gray.channels() == 4)
+            cv::cvtColor(gray, gray, cv::COLOR_BGRA2GRAY);
+        CheckReturn(gray.channels() == 1, cv::Mat());
+
+        if (gray.depth() != CV_8U && gray.depth() != CV_16U)
+            gray.convertTo(gray, CV_8U);
+        return gray;
+    }
+}
+
+GLDM::GLDM(const std::filesystem::path& img, const Real alpha, const Real delta, int threads, GLDMKernel kernel)
 {
-    readImage(img, alpha, delta);
+    readImage(img, alpha, delta, threads, kernel);
 }
 
-bool GLDM::readImage(const std::filesystem::path& img, const Real alpha, const Real delta)
+bool GLDM::readImage(const std::filesystem::path& img, const Real alpha, const Real delta, int threads, GLDMKernel kernel)
 {
     try
     {
-        image = cv::imread(img.string());
-        CheckReturn(isImageLoaded(), false);
-        computeGLDM(alpha, delta);
-        return true;
+        CheckReturn(loadImage(img), false);
+        computeGLDM(delta, alpha, kernel, threads);
+        return isMatrixComputed();
     }
     catch (...)
     {
@@ -24,45 +414,236 @@ bool GLDM::readImage(const std::filesystem::path& img, const Real alpha, const R
     }
 }
 
-void misis::GLDM::computeGLDM(Real delta, Real alpha) {
-    int Ng = 256;
-    int maxDependence = 8;
-    cv::Mat P = cv::Mat::zeros(Ng, maxDependence + 1, CV_64F);
+bool GLDM::loadImage(const std::filesystem::path& img, int reduction)
+{
+    int flags = 0;
+    CheckReturn(decodeFlags(reduction, flags), false);
 
-    for (int y = 0; y < image.rows; ++y) {
-        for (int x = 0; x < image.cols; ++x) {
-            int centerVal = image.at<uchar>(y, x);
-            int count = 0;
+    try
+    {
+        GLDM_PROFILE_SCOPE("GLDM::loadImage");
+        wasGlDMComputed = false;
+        const bool loaded = readMappedImage(img, flags, image, mapping);
+        GLDM_PROFILE_PIXELS(image.total());
+        return loaded;
+    }
+    catch (...)
+    {
+        return false;
+    }
+}
 
-            for (int dy = -delta; dy <= delta; ++dy) {
-                for (int dx = -delta; dx <= delta; ++dx) {
-                    if (dx == 0 && dy == 0) continue;
+bool GLDM::decodeImage(const uchar* data, size_t size, int reduction)
+{
+    int flags = 0;
+    CheckReturn(decodeFlags(reduction, flags), false);
+    CheckReturn(data != nullptr && size > 0 && size <= static_cast<size_t>(std::numeric_limits<int>::max()), false);
 
-                    int nx = x + dx;
-                    int ny = y + dy;
+    try
+    {
+        GLDM_PROFILE_SCOPE("GLDM::decodeImage");
+        // Decoding into the previous buffer reuses it for an image of the same size and type.
+        if (!reusableImageBuffer(image))
+            image.release();
+        mapping.reset();
+        if (cv::imdecode(cv::Mat(1, static_cast<int>(size), CV_8U, const_cast<uchar*>(data)), flags, &image).empty())
+            image.release();
+        GLDM_PROFILE_PIXELS(image.total());
+        wasGlDMComputed = false;
+        return isImageLoaded();
+    }
+    catch (...)
+    {
+        return false;
+    }
+}
 
-                    if (nx >= 0 && ny >= 0 && nx < image.cols && ny < image.rows) {
-                        int neighborVal = image.at<uchar>(ny, nx);
-                        if (abs(centerVal - neighborVal) <= alpha) {
-                            count++;
-                        }
-                    }
-                }
-            }
+bool GLDM::isValidQuantization(const GLDMQuantization& levels)
+{
+    return levels.grayLevels >= 2 && levels.grayLevels <= maxGrayLevels
+        && (levels.mode == QuantizationMode::Linear || levels.binWidth >= 1);
+}
 
-            if (count <= maxDependence)
-                P.at<double>(centerVal, count)++;
-        }
-    }
+bool GLDM::setQuantization(const GLDMQuantization& levels)
+{
+    CheckReturn(isValidQuantization(levels), false);
+    quantization = levels;
+    wasGlDMComputed = false;
+    return true;
+}
+
+const GLDMQuantization& GLDM::getQuantization() const
+{
+    return quantization;
+}
+
+void misis::GLDM::computeGLDM(Real delta, Real alpha, GLDMKernel kernel, int threads) {
+    CheckReturn_Void(isImageLoaded());
+    // The previous matrix is recomputed in place, so an object reused for many images does not reallocate it.
+    wasGlDMComputed = computeMatrixInto(image, delta, alpha, quantization, kernel, threads, matrix);
+    if (!wasGlDMComputed)
+        matrix = GLDMMatrix();
+}
+
+GLDMMatrix GLDM::computeMatrix(const cv::Mat& view, Real delta, Real alpha, const GLDMQuantization& quantization,
+    GLDMKernel kernel, int threads)
+{
+    GLDMMatrix result;
+    if (!computeMatrixInto(view, delta, alpha, quantization, kernel, threads, result))
+        return GLDMMatrix();
+    return result;
+}
+
+GLDMMatrix GLDM::computeMatrix(const cv::Mat& view, const cv::Rect& roi, Real delta, Real alpha,
+    const GLDMQuantization& quantization, GLDMKernel kernel, int threads)
+{
+    CheckReturn(roi.x >= 0 && roi.y >= 0 && roi.width > 0 && roi.height > 0
+        && roi.x + roi.width <= view.cols && roi.y + roi.height <= view.rows, GLDMMatrix());
+    // Pixels outside the ROI are treated as outside the image, exactly as if the ROI were cropped out.
+    return computeMatrix(view(roi), delta, alpha, quantization, kernel, threads);
+}
+
+GLDMMatrix GLDM::computeMatrix(const uint8_t* data, int width, int height, size_t stride, Real delta, Real alpha,
+    const GLDMQuantization& quantization, GLDMKernel kernel, int threads)
+{
+    CheckReturn(data && width > 0 && height > 0 && stride >= static_cast<size_t>(width), GLDMMatrix());
+    const cv::Mat view(height, width, CV_8UC1, const_cast<uint8_t*>(data), stride);
+    return computeMatrix(view, delta, alpha, quantization, kernel, threads);
+}
+
+GLDMMatrix GLDM::computeMatrix(const uint16_t* data, int width, int height, size_t stride, Real delta, Real alpha,
+    const GLDMQuantization& quantization, GLDMKernel kernel, int threads)
+{
+    CheckReturn(data && width > 0 && height > 0 && stride >= static_cast<size_t>(width) * sizeof(uint16_t), GLDMMatrix());
+    const cv::Mat view(height, width, CV_16UC1, const_cast<uint16_t*>(data), stride);
+    return computeMatrix(view, delta, alpha, quantization, kernel, threads);
+}
+
+GLDMFeatureSet GLDM::computeFeatures(const cv::Mat& view, Real delta, Real alpha, const GLDMQuantization& quantization,
+    GLDMKernel kernel, int threads)
+{
+    return computeMatrix(view, delta, alpha, quantization, kernel, threads).computeAllFeatures();
+}
+
+cv::Mat GLDM::computeDependenceMap(Real delta, Real alpha, int threads) const
+{
+    CheckReturn(isImageLoaded(), cv::Mat());
+
+    const kernels::Neighbourhood hood = kernels::makeNeighbourhood(delta, alpha, std::max(image.rows, image.cols));
+    if (quantization.grayLevels <= 256)
+        return computeDependence<uchar>(image, quantization, hood, alpha, threads);
+    return computeDependence<ushort>(image, quantization, hood, alpha, threads);
+}
 
-    P.copyTo(image);
+cv::Mat GLDM::computeLevelImage() const
+{
+    CheckReturn(isImageLoaded(), cv::Mat());
+
+    cv::Mat levels(image.rows, image.cols, quantization.grayLevels <= 256 ? CV_8UC1 : CV_16UC1);
+    const auto quantizeAll = [&](auto zero) {
+        using Level = decltype(zero);
+        const std::vector<Level> table = makeLevelTable<Level>(quantization, image.depth());
+        for (int y = 0; y < image.rows; ++y)
+            quantizeRow(image.ptr<uchar>(y), image.depth(), image.cols, table, levels.ptr<Level>(y));
+    };
+    if (levels.depth() == CV_8U)
+        quantizeAll(uchar{});
+    else
+        quantizeAll(ushort{});
+    return levels;
+}
+
+GLDMFeatureMaps GLDM::computeFeatureMaps(int windowSize, Real delta, Real alpha, int threads) const
+{
+    CheckReturn(isImageLoaded(), GLDMFeatureMaps{});
+    GLDM_PROFILE_SCOPE("GLDM::computeFeatureMaps");
+    GLDM_PROFILE_PIXELS(image.total());
+
+    const kernels::Neighbourhood hood = kernels::makeNeighbourhood(delta, alpha, std::max(image.rows, image.cols));
+    return misis::computeFeatureMaps(computeLevelImage(), computeDependenceMap(delta, alpha, threads),
+        GLDMMatrix::maxDependenceForRadius(hood.radius, image.rows, image.cols), windowSize, threads);
+}
+
+bool GLDM::computeGLDMStreaming(const std::filesystem::path& img, Real delta, Real alpha, GLDMKernel kernel)
+{
+    GLDM_PROFILE_SCOPE("GLDM::computeGLDMStreaming");
+    std::unique_ptr<RowSource> source = openRowSource(img);
+    if (!source)
+        return false;
+    GLDM_PROFILE_PIXELS(static_cast<uint64_t>(source->rows()) * source->cols());
+
+    const kernels::Neighbourhood hood = kernels::makeNeighbourhood(delta, alpha, std::max(source->rows(), source->cols()));
+    GLDMMatrix result;
+    const bool ok = quantization.grayLevels <= 256
+        ? computeMatrixStreaming<uchar>(*source, quantization, hood, resolveRowKernel<uchar>(kernel, hood, alpha), result)
+        : computeMatrixStreaming<ushort>(*source, quantization, hood, resolveRowKernel<ushort>(kernel, hood, alpha), result);
+    CheckReturn(ok, false);
+
+    image.release();
+    mapping.reset();
+    matrix = std::move(result);
     wasGlDMComputed = true;
+    return true;
 }
 
+std::vector<GLDMMatrix> GLDM::computeSweep(const std::vector<Real>& deltas, const std::vector<Real>& alphas, int threads) const
+{
+    CheckReturn(isImageLoaded() && !deltas.empty() && !alphas.empty(), {});
+    GLDM_PROFILE_SCOPE("GLDM::computeSweep");
+    GLDM_PROFILE_PIXELS(image.total());
+
+    const int extent = std::max(image.rows, image.cols);
+    std::vector<int> radii;
+    std::vector<int> thresholds;
+    for (const Real delta : deltas)
+        radii.push_back(kernels::makeNeighbourhood(delta, 0.0f, extent).radius);
+    for (const Real alpha : alphas)
+        thresholds.push_back(kernels::makeNeighbourhood(0.0f, alpha, extent).threshold);
+
+    if (quantization.grayLevels <= 256)
+        return computeSweepMatrices<uchar>(image, quantization, thresholds, radii, threads);
+    return computeSweepMatrices<ushort>(image, quantization, thresholds, radii, threads);
+}
+
+int GLDM::maxDeltaFor(int grayLevels)
+{
+    int delta = maxDelta;
+    while (delta > 0 && static_cast<size_t>(std::max(grayLevels, 1))
+        * (GLDMMatrix::maxDependenceForRadius(delta, delta * 2 + 1, delta * 2 + 1) + 1) > GLDMMatrix::maxCells)
+        --delta;
+    return delta;
+}
+
+bool GLDM::isValidDelta(Real delta, int grayLevels)
+{
+    // Written so that NaN fails both comparisons.
+    return delta >= 0 && delta < static_cast<Real>(maxDeltaFor(grayLevels) + 1);
+}
+
+int GLDM::partialBands(int threads, int rows, size_t cells)
+{
+    const int wanted = std::max(1, std::min(threads <= 0 ? cv::getNumberOfCPUs() : threads, rows));
+    const size_t affordable = std::max<size_t>(1, GLDMMatrix::maxCells / std::max<size_t>(cells, 1));
+    return static_cast<int>(std::min<size_t>(wanted, affordable));
+}
+
+GLDMKernel GLDM::selectKernel(Real delta, Real alpha)
+{
+    const kernels::Neighbourhood hood = kernels::makeNeighbourhood(delta, alpha, std::numeric_limits<int>::max());
+    if (kernels::specializedRowKernel<uchar>(hood.radius))
+        return GLDMKernel::Specialized;
+    if (kernels::isSimdAvailable(hood.radius))
+        return GLDMKernel::Simd;
+    return GLDMKernel::Scalar;
+}
 
 bool misis::GLDM::importImageFromMat(const cv::Mat& mat)
 {
-    mat.copyTo(image);
+    // A mapped image is read-only, so it must not be reused as the copy destination.
+    image.release();
+    mapping.reset();
+    toGrayLevels(mat).copyTo(image);
+    wasGlDMComputed = false;
     return isImageLoaded();
 }
 
@@ -71,21 +652,52 @@ bool [[nodiscard]] GLDM::isImageLoaded() const
     return !image.empty(); //&& wasGlDMComputed;
 }
 
+void GLDM::releaseImage()
+{
+    image.release();
+    mapping.reset();
+}
+
+cv::Mat GLDM::getImage() const
+{
+    // The mapping dies with this object, so the caller gets its own pixels.
+    return mapping ? image.clone() : image;
+}
+
+void GLDM::setMatrix(GLDMMatrix computed)
+{
+    matrix = std::move(computed);
+    wasGlDMComputed = !matrix.empty();
+}
+
+bool GLDM::isMatrixComputed() const
+{
+    return wasGlDMComputed;
+}
+
+const GLDMMatrix& GLDM::getMatrix() const
+{
+    return matrix;
+}
+
+GLDMFeatureSet GLDM::computeAllFeatures() const
+{
+    CheckReturn(wasGlDMComputed, GLDMFeatureSet{});
+    GLDM_PROFILE_SCOPE("GLDM::computeAllFeatures");
+    return matrix.computeAllFeatures();
+}
+
 Real [[nodiscard]] GLDM::getDependenceNonUniformityFeatureValue() const
 {
-    CheckReturn(isImageLoaded(), 0.0f);
     CheckReturn(wasGlDMComputed, 0.0f);
-    
-    double Nz = sum(image)[0];
-    CheckReturn(Nz < std::numeric_limits<double>::epsilon() || Nz > std::numeric_limits<double>::epsilon(), 0.0f);
+
+    const double Nz = static_cast<double>(matrix.totalCount());
+    CheckReturn(Nz > 0.0, 0.0f);
 
     double result = 0.0;
-    for (int j = 0; j < image.cols; ++j) {
-        double colSum = 0.0;
-        for (int i = 0; i < image.rows; ++i) {
-            colSum += image.at<double>(i, j);
-        }
-        result += colSum * colSum;
+    for (const uint64_t colSum : matrix.dependenceSums()) {
+        const double value = static_cast<double>(colSum);
+        result += value * value;
     }
     return result / Nz;
 
@@ -93,17 +705,15 @@ Real [[nodiscard]] GLDM::getDependenceNonUniformityFeatureValue() const
 
 Real [[nodiscard]] GLDM::getLowGrayLevelEmphasisFeatureValue() const
 {
-    CheckReturn(isImageLoaded(), 0.0f);
     CheckReturn(wasGlDMComputed, 0.0f);
 
-    double Nz = sum(image)[0];
-    CheckReturn(Nz < std::numeric_limits<double>::epsilon() || Nz > std::numeric_limits<double>::epsilon(), 0.0f);
+    const double Nz = static_cast<double>(matrix.totalCount());
+    CheckReturn(Nz > 0.0, 0.0f);
 
+    const std::vector<uint64_t>& rowSums = matrix.grayLevelSums();
     double result = 0.0;
-    for (int i = 0; i < image.rows; ++i) {
-        for (int j = 0; j < image.cols; ++j) {
-            result += image.at<double>(i, j) / ((i + 1.0) * (i + 1.0));
-        }
+    for (size_t i = 0; i < rowSums.size(); ++i) {
+        result += static_cast<double>(rowSums[i]) / ((i + 1.0) * (i + 1.0));
     }
     return result / Nz;
 }
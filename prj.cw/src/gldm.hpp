@@ -4,7 +4,12 @@
 #define GLDM_2025
 
 #include <filesystem>
+#include <iostream>
 #include <opencv2/opencv.hpp>
+#include "gldmmatrix.hpp"
+#include "featuremaps.hpp"
+#include "mappedfile.hpp"
+#include <memory>
 
 #ifdef _WIN32
 #include <Windows.h>
@@ -42,6 +47,32 @@ namespace misis {
     
     using Real = float;
 
+    /// \brief Реализация подсчёта зависимых соседей в `GLDM::computeGLDM`.
+    enum class GLDMKernel
+    {
+        Auto, ///< Самая быстрая из доступных реализаций.
+        Scalar, ///< Попиксельный обход с проверкой границ.
+        Simd, ///< Построчный векторный обход на универсальных интринсиках OpenCV.
+        Specialized ///< Развёрнутое ядро для delta = 1, 2, 3; для остальных радиусов используется `Simd`.
+    };
+
+    /// \brief Способ перевода значений пикселей в уровни серого матрицы.
+    enum class QuantizationMode
+    {
+        Linear, ///< Диапазон типа пикселя (256 или 65536 значений) делится на Ng равных интервалов.
+        FixedBin ///< Уровень - `value / binWidth`, значения за последним уровнем попадают в него.
+    };
+
+    /// \brief Параметры квантования уровней серого.
+    ///
+    /// Значения по умолчанию для 8-битного изображения дают тождественное квантование.
+    struct GLDMQuantization
+    {
+        int grayLevels = 256; ///< Число уровней серого Ng (строк матрицы), от 2 до 65536.
+        QuantizationMode mode = QuantizationMode::Linear; ///< Способ квантования.
+        int binWidth = 1; ///< Ширина интервала для `FixedBin`.
+    };
+
     /// \brief Класс для вычисления GLDM (Gray Level Dependence Matrix) характеристик изображения.
     class GLDM final
     {
@@ -51,29 +82,210 @@ namespace misis {
 
         /// \brief Конструктор с загрузкой изображения.
         /// \param[in] img Путь к изображению.
-        GLDM(const std::filesystem::path& img, const Real alpha, const Real delta);
+        /// \param[in] threads Число потоков для вычисления матрицы (0 - все ядра).
+        /// \param[in] kernel Реализация подсчёта соседей.
+        GLDM(const std::filesystem::path& img, const Real alpha, const Real delta, int threads = 1, GLDMKernel kernel = GLDMKernel::Auto);
 
         /// \brief Деструктор по умолчанию.
         ~GLDM() = default;
 
         /// \brief Загружает изображение из файла.
         /// \param[in] img Путь к изображению.
+        /// \param[in] threads Число потоков для вычисления матрицы (0 - все ядра).
+        /// \param[in] kernel Реализация подсчёта соседей.
         /// \return `true`, если изображение успешно загружено, иначе `false`.
-        bool readImage(const std::filesystem::path& img, const Real alpha, const Real delta);
+        bool readImage(const std::filesystem::path& img, const Real alpha, const Real delta, int threads = 1, GLDMKernel kernel = GLDMKernel::Auto);
+
+        /// \brief Загружает изображение из файла без вычисления матрицы.
+        ///
+        /// Файл отображается в память и декодируется `cv::imdecode` без промежуточного буфера;
+        /// 8-битный PGM в полном разрешении не декодируется, а используется прямо из отображения
+        /// (см. `readMappedImage`).
+        /// При `reduction` 2, 4 или 8 изображение сразу декодируется уменьшенным в 8-битный серый
+        /// (`IMREAD_REDUCED_GRAYSCALE_*`): JPEG масштабируется ещё в частотной области и декодируется
+        /// в несколько раз быстрее. Признаки такого изображения приближённые.
+        /// \param[in] img Путь к изображению.
+        /// \param[in] reduction Во сколько раз уменьшить каждую сторону: 1, 2, 4 или 8.
+        /// \return `true`, если изображение успешно загружено, иначе `false`.
+        bool loadImage(const std::filesystem::path& img, int reduction = 1);
+
+        /// \brief Декодирует изображение из закодированных байтов файла (PNG, JPEG, PGM и т. д.).
+        /// \param[in] data Содержимое файла изображения.
+        /// \param[in] size Размер содержимого в байтах.
+        /// \param[in] reduction Во сколько раз уменьшить каждую сторону: 1, 2, 4 или 8 (см. `loadImage`).
+        /// \return `true`, если изображение успешно декодировано, иначе `false`.
+        bool decodeImage(const uchar* data, size_t size, int reduction = 1);
 
         /// \brief Вычисляет GLDM и соответствующие признаки.
+        ///
+        /// Результат сохраняется в `GLDMMatrix` размера `Ng x (GLDMMatrix::maxDependenceForRadius + 1)`,
+        /// исходное изображение не изменяется. Память предыдущей матрицы используется повторно.
+        /// Пиксели переводятся в уровни серого (см. `setQuantization`) в том же проходе, что и подсчёт соседей:
+        /// каждая строка квантуется один раз, когда попадает в окно `2 * delta + 1` строк. Порог alpha
+        /// сравнивается с разностью квантованных уровней.
         /// \param[in] delta Параметр допуска для определения зависимостей уровней серого.
         /// \param[in] alpha Параметр веса зависимости.
-        void computeGLDM(Real delta, Real alpha);
+        /// \param[in] kernel Реализация подсчёта соседей. Все реализации дают одинаковую матрицу.
+        /// \param[in] threads Число потоков (0 - все ядра). Изображение делится на горизонтальные полосы,
+        /// каждая полоса считается в собственную гистограмму, результат не зависит от числа потоков.
+        /// Если матрицу вычислить нельзя (например, в изображении больше `GLDMMatrix::maxPixels` пикселей
+        /// и счётчики переполнились бы), `isMatrixComputed` возвращает `false`.
+        void computeGLDM(Real delta, Real alpha, GLDMKernel kernel = GLDMKernel::Auto, int threads = 1);
+
+        /// \brief Вычисляет GLDM изображения, не копируя его и не меняя состояние объекта.
+        ///
+        /// Подходит для кадров, уже лежащих в чужих буферах: строки читаются через `view.step`,
+        /// поэтому `view` может быть подматрицей большего изображения.
+        /// \param[in] view Изображение `CV_8UC1` или `CV_16UC1`.
+        /// \param[in] delta Радиус поиска соседей.
+        /// \param[in] alpha Порог разности уровней серого.
+        /// \param[in] quantization Параметры квантования.
+        /// \param[in] kernel Реализация подсчёта соседей.
+        /// \param[in] threads Число потоков (0 - все ядра).
+        /// \return Матрица зависимостей; пустая матрица, если вход или параметры некорректны.
+        [[nodiscard]] static GLDMMatrix computeMatrix(const cv::Mat& view, Real delta, Real alpha,
+            const GLDMQuantization& quantization = {}, GLDMKernel kernel = GLDMKernel::Auto, int threads = 1);
+
+        /// \brief Вычисляет GLDM прямоугольной области изображения без копирования.
+        ///
+        /// Пиксели вне `roi` считаются лежащими за границей изображения.
+        /// \param[in] view Изображение `CV_8UC1` или `CV_16UC1`.
+        /// \param[in] roi Область внутри `view`.
+        [[nodiscard]] static GLDMMatrix computeMatrix(const cv::Mat& view, const cv::Rect& roi, Real delta, Real alpha,
+            const GLDMQuantization& quantization = {}, GLDMKernel kernel = GLDMKernel::Auto, int threads = 1);
+
+        /// \brief Вычисляет GLDM 8-битного изображения во внешнем буфере.
+        /// \param[in] data Первый пиксель верхней строки.
+        /// \param[in] width Ширина в пикселях.
+        /// \param[in] height Высота в пикселях.
+        /// \param[in] stride Расстояние между началами строк в байтах.
+        [[nodiscard]] static GLDMMatrix computeMatrix(const uint8_t* data, int width, int height, size_t stride,
+            Real delta, Real alpha, const GLDMQuantization& quantization = {}, GLDMKernel kernel = GLDMKernel::Auto, int threads = 1);
+
+        /// \brief Вычисляет GLDM 16-битного изображения во внешнем буфере.
+        /// \param[in] stride Расстояние между началами строк в байтах.
+        [[nodiscard]] static GLDMMatrix computeMatrix(const uint16_t* data, int width, int height, size_t stride,
+            Real delta, Real alpha, const GLDMQuantization& quantization = {}, GLDMKernel kernel = GLDMKernel::Auto, int threads = 1);
+
+        /// \brief Вычисляет полный набор признаков GLDM изображения без копирования.
+        /// \param[in] view Изображение `CV_8UC1` или `CV_16UC1`, в том числе подматрица.
+        [[nodiscard]] static GLDMFeatureSet computeFeatures(const cv::Mat& view, Real delta, Real alpha,
+            const GLDMQuantization& quantization = {}, GLDMKernel kernel = GLDMKernel::Auto, int threads = 1);
+
+        /// \brief Вычисляет GLDM, читая изображение построчно.
+        ///
+        /// В памяти одновременно находятся только `2 * delta + 1` строк, поэтому пиковое потребление
+        /// зависит от ширины изображения, а не от площади. Матрица совпадает с `readImage` + `computeGLDM`.
+        /// Изображение при этом не сохраняется.
+        /// \param[in] img Путь к изображению. Поддерживается 8- и 16-битный бинарный PGM.
+        /// \param[in] delta Радиус поиска соседей.
+        /// \param[in] alpha Порог разности уровней серого.
+        /// \param[in] kernel Реализация подсчёта соседей.
+        /// \return `false`, если формат не поддерживает построчное чтение, файл повреждён
+        ///         или в изображении больше `GLDMMatrix::maxPixels` пикселей.
+        bool computeGLDMStreaming(const std::filesystem::path& img, Real delta, Real alpha, GLDMKernel kernel = GLDMKernel::Auto);
+
+        /// \brief Вычисляет матрицы для всех пар (alpha, delta) за один обход изображения.
+        ///
+        /// Разность с каждым соседом считается один раз и обновляет матрицы всех порогов и вложенных окон.
+        /// Состояние объекта не меняется.
+        /// \param[in] deltas Радиусы поиска соседей.
+        /// \param[in] alphas Пороги разности уровней серого.
+        /// \param[in] threads Число потоков (0 - все ядра).
+        /// \return Матрицы в порядке `alphas[a], deltas[d]` с индексом `a * deltas.size() + d`.
+        [[nodiscard]] std::vector<GLDMMatrix> computeSweep(const std::vector<Real>& deltas, const std::vector<Real>& alphas, int threads = 1) const;
+
+        /// \brief Вычисляет для каждого пикселя число зависимых соседей.
+        /// \param[in] delta Радиус поиска соседей.
+        /// \param[in] alpha Порог разности уровней серого.
+        /// \param[in] threads Число потоков (0 - все ядра).
+        /// \return Карта `CV_32S` того же размера, что и изображение.
+        [[nodiscard]] cv::Mat computeDependenceMap(Real delta, Real alpha, int threads = 1) const;
+
+        /// \brief Переводит изображение в уровни серого матрицы.
+        /// \return `CV_8U` при Ng не больше 256, иначе `CV_16U`.
+        [[nodiscard]] cv::Mat computeLevelImage() const;
+
+        /// \brief Вычисляет карты локальных признаков LGLE и DN в скользящем окне.
+        /// \param[in] windowSize Сторона окна W (нечётная).
+        /// \param[in] delta Радиус поиска соседей.
+        /// \param[in] alpha Порог разности уровней серого.
+        /// \param[in] threads Число потоков (0 - все ядра).
+        [[nodiscard]] GLDMFeatureMaps computeFeatureMaps(int windowSize, Real delta, Real alpha, int threads = 1) const;
+
+        /// \brief Выбирает самую быструю реализацию подсчёта соседей для заданных параметров.
+        /// \param[in] delta Радиус поиска соседей.
+        /// \param[in] alpha Порог разности уровней серого.
+        /// \return `Specialized` для delta = 1, 2, 3, иначе `Simd` или `Scalar`, если векторное ядро недоступно.
+        static GLDMKernel selectKernel(Real delta, Real alpha);
+
+        /// \brief Задаёт число уровней серого и способ квантования для следующих вычислений.
+        /// \param[in] levels Параметры квантования.
+        /// \return `false`, если параметры некорректны; текущие параметры при этом не меняются.
+        bool setQuantization(const GLDMQuantization& levels);
+
+        /// \brief Проверяет параметры квантования: Ng от 2 до `maxGrayLevels`, положительная ширина интервала.
+        static bool isValidQuantization(const GLDMQuantization& levels);
+
+        /// \brief Возвращает текущие параметры квантования.
+        [[nodiscard]] const GLDMQuantization& getQuantization() const;
 
         /// \brief Импортирует изображение из объекта OpenCV `cv::Mat`.
+        ///
+        /// Изображение копируется; чтобы посчитать матрицу без копии, используйте `computeMatrix`.
+        ///
+        /// Цветное изображение переводится в оттенки серого, глубины кроме `CV_8U` и `CV_16U` - в `CV_8U`.
         /// \param[in] mat Изображение.
         /// \return `true`, если импорт прошел успешно, иначе `false`.
         bool importImageFromMat(const cv::Mat& mat);
 
+        static constexpr int maxGrayLevels = 65536; ///< Наибольшее поддерживаемое число уровней серого.
+        static constexpr int maxDelta = 127; ///< Наибольший delta; окно `255 x 255` даёт не больше 65024 соседей.
+
+        /// \brief Наибольший delta, при котором матрица `Ng x (2 * delta + 1)^2` помещается в `GLDMMatrix::maxCells`.
+        /// \param[in] grayLevels Число уровней серого Ng.
+        /// \return Значение от 0 до `maxDelta`.
+        static int maxDeltaFor(int grayLevels);
+
+        /// \brief Проверяет delta до выделения памяти: число от 0 до `maxDeltaFor(grayLevels)` включительно.
+        ///
+        /// Отклоняет и NaN, и бесконечность. Вычисления с большим delta на маленьких изображениях
+        /// по-прежнему допустимы (окно обрезается размером изображения), проверка нужна для входных параметров.
+        static bool isValidDelta(Real delta, int grayLevels = 256);
+
+        /// \brief Число полос с собственной частичной матрицей при многопоточном подсчёте.
+        ///
+        /// Не больше `threads` и `rows`, а частичные матрицы всех полос вместе занимают не больше
+        /// `GLDMMatrix::maxCells` ячеек; при большом Ng и delta потоков становится меньше, но не меньше одного.
+        /// \param[in] threads Число потоков (0 - все ядра).
+        /// \param[in] rows Число строк изображения.
+        /// \param[in] cells Ячеек во всех матрицах одной полосы.
+        static int partialBands(int threads, int rows, size_t cells);
+
         /// \brief Проверяет верную загрузку изображения.
         bool [[nodiscard]] isImageLoaded() const;
 
+        /// \brief Освобождает изображение, чтобы объект, используемый повторно, не анализировал прежнее.
+        void releaseImage();
+
+        /// \brief Возвращает загруженное изображение (пустое после `computeGLDMStreaming`).
+        ///
+        /// Изображение, прочитанное без копирования из отображения файла, возвращается копией.
+        [[nodiscard]] cv::Mat getImage() const;
+
+        /// \brief Устанавливает готовую матрицу, например прочитанную из кэша.
+        /// \param[in] computed Матрица с вычисленными суммами (`updateMarginals`).
+        void setMatrix(GLDMMatrix computed);
+
+        /// \brief Проверяет, что матрица вычислена или установлена.
+        [[nodiscard]] bool isMatrixComputed() const;
+
+        /// \brief Возвращает вычисленную матрицу зависимостей.
+        [[nodiscard]] const GLDMMatrix& getMatrix() const;
+
+        /// \brief Вычисляет полный набор признаков GLDM за один проход по матрице.
+        [[nodiscard]] GLDMFeatureSet computeAllFeatures() const;
+
         /// \brief Возвращает значение признака Dependence Non-Uniformity (DN).
         Real [[nodiscard]] getDependenceNonUniformityFeatureValue() const;
         
@@ -81,7 +293,10 @@ namespace misis {
         Real [[nodiscard]] getLowGrayLevelEmphasisFeatureValue() const;
 
     private:
-        cv::Mat image; ///< Изображение для анализа.
+        cv::Mat image; ///< Изображение для анализа, `CV_8U` или `CV_16U`.
+        GLDMQuantization quantization; ///< Параметры квантования уровней серого.
+        std::shared_ptr<const MappedFile> mapping; ///< Файл, на пиксели которого указывает `image` (8-битный PGM).
+        GLDMMatrix matrix; ///< Матрица зависимостей, вычисленная `computeGLDM`.
         bool wasGlDMComputed : 1 = false; ///< Флаг на вычисление матрицы.
     };
 }
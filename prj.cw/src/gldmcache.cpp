@@ -0,0 +1,449 @@
+#include "gldmcache.hpp"
+#include "kernels.hpp"
+#include "mappedfile.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace misis;
+
+namespace
+{
+    constexpr char entryMagic[8] = { 'G', 'L', 'D', 'M', 'C', '0', '0', '1' };
+    constexpr const char* entryExtension = ".gldm";
+    constexpr char indexMagic[8] = { 'G', 'L', 'D', 'M', 'C', 'I', 'X', '1' };
+    constexpr const char* indexName = "index.bin";
+    constexpr int shardCount = 256; ///< Подпапки `00` ... `ff` по первому байту идентификатора.
+
+    /// \brief Заголовок файла записи, за ним следуют `grayLevels * dependenceSizes` счётчиков uint32.
+    struct EntryHeader
+    {
+        char magic[8];
+        GLDMCacheKey key;
+        int32_t grayLevels;
+        int32_t dependenceSizes;
+    };
+    static_assert(std::is_trivially_copyable_v<EntryHeader> && sizeof(EntryHeader) == 64);
+
+    /// \brief Заголовок файла индекса, за ним следуют `count` записей `IndexRecord`.
+    struct IndexHeader
+    {
+        char magic[8];
+        uint64_t count;
+    };
+    static_assert(std::is_trivially_copyable_v<IndexHeader> && sizeof(IndexHeader) == 16);
+
+    /// \brief Запись индекса: идентификатор и размер файла записи кэша.
+    struct IndexRecord
+    {
+        std::array<uint64_t, 4> id;
+        uint64_t size;
+    };
+    static_assert(std::is_trivially_copyable_v<IndexRecord> && sizeof(IndexRecord) == 40);
+
+    /// \brief Идентификатор в шестнадцатеричном виде, 64 символа.
+    std::string toHex(const std::array<uint64_t, 4>& id)
+    {
+        static constexpr char digits[] = "0123456789abcdef";
+        std::string text;
+        for (const uint64_t word : id)
+            for (int shift = 60; shift >= 0; shift -= 4)
+                text += digits[(word >> shift) & 0xF];
+        return text;
+    }
+
+    /// \brief Разбирает идентификатор из имени файла записи.
+    /// \return `false`, если это не 64 шестнадцатеричных символа.
+    bool fromHex(const std::string& text, std::array<uint64_t, 4>& id)
+    {
+        if (text.size() != 64)
+            return false;
+        id = {};
+        for (size_t k = 0; k < text.size(); ++k) {
+            const char c = text[k];
+            const int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+            if (digit < 0)
+                return false;
+            id[k / 16] = (id[k / 16] << 4) | static_cast<uint64_t>(digit);
+        }
+        return true;
+    }
+
+    /// \brief Имя подпапки записей с первым байтом идентификатора `shard`.
+    std::string shardName(int shard)
+    {
+        static constexpr char digits[] = "0123456789abcdef";
+        return { digits[(shard >> 4) & 0xF], digits[shard & 0xF] };
+    }
+
+    /// \brief Суффикс временного файла, уникальный для процесса и вызова.
+    ///
+    /// Одну запись могут одновременно сохранять несколько процессов, поэтому в имени есть и pid, и счётчик.
+    std::string temporarySuffix()
+    {
+        static std::atomic<uint64_t> counter = 0;
+#ifdef _WIN32
+        const auto pid = _getpid();
+#else
+        const auto pid = getpid();
+#endif
+        return ".tmp" + std::to_string(pid) + "-" + std::to_string(counter++);
+    }
+
+    inline uint64_t rotl(uint64_t x, int r)
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    /// \brief Финальное перемешивание MurmurHash3.
+    inline uint64_t mix(uint64_t x)
+    {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+    /// \brief 128-битный некриптографический хеш по блокам 16 байт.
+    void hashBytes(const uint8_t* data, size_t size, uint64_t hash[2])
+    {
+        uint64_t h1 = 0x9e3779b97f4a7c15ULL;
+        uint64_t h2 = 0xc2b2ae3d27d4eb4fULL;
+        const auto block = [&](uint64_t a, uint64_t b) {
+            h1 = rotl(h1 ^ mix(a), 27) * 0x87c37b91114253d5ULL + b;
+            h2 = rotl(h2 ^ mix(b), 31) * 0x4cf5ad432745937fULL + a;
+        };
+
+        size_t offset = 0;
+        for (; offset + 16 <= size; offset += 16) {
+            uint64_t a, b;
+            std::memcpy(&a, data + offset, 8);
+            std::memcpy(&b, data + offset + 8, 8);
+            block(a, b);
+        }
+        uint8_t tail[16] = {};
+        if (size > offset)
+            std::memcpy(tail, data + offset, size - offset);
+        uint64_t a, b;
+        std::memcpy(&a, tail, 8);
+        std::memcpy(&b, tail + 8, 8);
+        block(a, b);
+
+        h1 ^= size;
+        h2 ^= size;
+        h1 = mix(h1 + h2);
+        h2 = mix(h2 + h1);
+        hash[0] = h1;
+        hash[1] = h2;
+    }
+}
+
+bool GLDMCacheKey::fromFile(const std::filesystem::path& path, GLDMCacheKey& key)
+{
+    const MappedFile file(path);
+    if (!file.isOpen())
+        return false;
+
+    key = GLDMCacheKey{};
+    key.fileSize = file.size();
+    hashBytes(file.data(), file.size(), key.contentHash);
+    return true;
+}
+
+GLDMCacheKey GLDMCacheKey::withParameters(Real delta, Real alpha, const GLDMQuantization& quantization, int reduction) const
+{
+    // The image size is unknown before decoding, so the radius is not clamped to it here.
+    const kernels::Neighbourhood hood = kernels::makeNeighbourhood(delta, alpha, std::numeric_limits<int>::max());
+
+    GLDMCacheKey key = *this;
+    key.radius = hood.radius;
+    key.threshold = hood.threshold;
+    key.grayLevels = quantization.grayLevels;
+    key.quantizationMode = static_cast<int32_t>(quantization.mode);
+    key.binWidth = quantization.mode == QuantizationMode::FixedBin ? quantization.binWidth : 0;
+    key.decodeReduction = reduction;
+    return key;
+}
+
+std::array<uint64_t, 4> GLDMCacheKey::digest() const
+{
+    static_assert(std::is_trivially_copyable_v<GLDMCacheKey> && sizeof(GLDMCacheKey) == 48);
+    uint8_t bytes[sizeof(GLDMCacheKey)];
+    std::memcpy(bytes, this, sizeof(bytes));
+
+    // The content hash already spreads entries evenly; the parameters are hashed into the last word.
+    uint64_t parameters[2];
+    hashBytes(bytes + 24, sizeof(bytes) - 24, parameters);
+    return { contentHash[0], contentHash[1], fileSize, parameters[0] };
+}
+
+std::string GLDMCacheKey::fileName() const
+{
+    return toHex(digest()) + entryExtension;
+}
+
+GLDMCache::GLDMCache(const std::filesystem::path& directory, uint64_t maxBytes)
+    : directory(directory)
+    , maxBytes(maxBytes)
+{
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    valid = std::filesystem::is_directory(directory, error);
+    if (!valid) {
+        std::cerr << "Could not open the cache directory: " << directory.string() << std::endl;
+        return;
+    }
+
+    std::lock_guard lock(mutex);
+    if (!loadIndex())
+        scanEntries();
+    evict();
+}
+
+GLDMCache::~GLDMCache()
+{
+    if (!valid)
+        return;
+    try
+    {
+        saveIndex();
+    }
+    catch (const std::exception& e)
+    {
+        // Losing the index only costs a rescan on the next start.
+        std::cerr << "Could not save the cache index: " << e.what() << std::endl;
+    }
+}
+
+bool GLDMCache::isOpen() const
+{
+    return valid;
+}
+
+std::filesystem::path GLDMCache::entryPath(const EntryId& id) const
+{
+    return directory / shardName(static_cast<int>(id[0] >> 56)) / (toHex(id) + entryExtension);
+}
+
+bool GLDMCache::loadIndex()
+{
+    const std::filesystem::path path = directory / indexName;
+    {
+        const MappedFile file(path);
+        if (!file.isOpen() || file.size() < sizeof(IndexHeader))
+            return false;
+        IndexHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, indexMagic, sizeof(indexMagic)) != 0
+            || header.count != (file.size() - sizeof(IndexHeader)) / sizeof(IndexRecord)
+            || file.size() != sizeof(IndexHeader) + header.count * sizeof(IndexRecord))
+            return false;
+
+        for (uint64_t k = 0; k < header.count; ++k) {
+            IndexRecord record;
+            std::memcpy(&record, file.data() + sizeof(IndexHeader) + k * sizeof(IndexRecord), sizeof(record));
+            if (entries.count(record.id))
+                continue;
+            recency.push_back(record.id);
+            entries[record.id] = { std::prev(recency.end()), record.size };
+            totalBytes += record.size;
+        }
+    }
+
+    // The index is only valid while this process owns it: after a crash it would miss the entries written since,
+    // so it is removed now and written again when the cache is closed.
+    std::error_code error;
+    std::filesystem::remove(path, error);
+    return true;
+}
+
+void GLDMCache::scanEntries()
+{
+    // Only the error_code overloads are used: an unreadable folder or entry is skipped and never throws out of the constructor.
+    const auto addFolder = [&](const std::filesystem::path& folder) {
+        std::error_code error;
+        for (std::filesystem::directory_iterator it(folder, error), end; !error && it != end; it.increment(error)) {
+            const std::filesystem::path path = it->path();
+            EntryId id;
+            std::error_code entryError;
+            if (path.extension() != entryExtension || !fromHex(path.stem().string(), id) || !it->is_regular_file(entryError))
+                continue;
+            const uint64_t size = it->file_size(entryError);
+            if (entryError || entries.count(id))
+                continue;
+            recency.push_back(id);
+            entries[id] = { std::prev(recency.end()), size };
+            totalBytes += size;
+        }
+    };
+
+    for (int shard = 0; shard < shardCount; ++shard)
+        addFolder(directory / shardName(shard));
+}
+
+void GLDMCache::saveIndex() const
+{
+    const std::filesystem::path path = directory / indexName;
+    const std::filesystem::path temporary = directory / (std::string(indexName) + temporarySuffix());
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        std::lock_guard lock(mutex);
+        IndexHeader header{};
+        std::memcpy(header.magic, indexMagic, sizeof(indexMagic));
+        header.count = recency.size();
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        std::vector<IndexRecord> block;
+        block.reserve(4096);
+        const auto flush = [&] {
+            file.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(block.size() * sizeof(IndexRecord)));
+            block.clear();
+        };
+        for (const EntryId& id : recency) {
+            block.push_back({ id, entries.at(id).size });
+            if (block.size() == block.capacity())
+                flush();
+        }
+        flush();
+
+        if (!file) {
+            std::cerr << "Could not write the cache index: " << temporary.string() << std::endl;
+            file.close();
+            std::error_code error;
+            std::filesystem::remove(temporary, error);
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error)
+        std::filesystem::remove(temporary, error);
+}
+
+bool GLDMCache::load(const GLDMCacheKey& key, GLDMMatrix& matrix)
+{
+    if (!valid)
+        return false;
+
+    const EntryId id = key.digest();
+    const MappedFile file(entryPath(id));
+    if (!file.isOpen()) {
+        std::lock_guard lock(mutex);
+        forget(id);
+        return false;
+    }
+    if (file.size() < sizeof(EntryHeader))
+        return false;
+
+    EntryHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    const size_t countBytes = static_cast<size_t>(std::max(header.grayLevels, 0)) * std::max(header.dependenceSizes, 0) * sizeof(uint32_t);
+    if (std::memcmp(header.magic, entryMagic, sizeof(entryMagic)) != 0 || !(header.key == key)
+        || header.grayLevels <= 0 || header.dependenceSizes <= 0 || file.size() != sizeof(EntryHeader) + countBytes)
+        return false;
+
+    matrix = GLDMMatrix(header.grayLevels, header.dependenceSizes - 1);
+    std::memcpy(matrix.data(), file.data() + sizeof(EntryHeader), countBytes);
+    matrix.updateMarginals();
+
+    // The access order lives in the index only, so a hit costs no metadata write.
+    std::lock_guard lock(mutex);
+    touch(id, file.size());
+    return true;
+}
+
+void GLDMCache::store(const GLDMCacheKey& key, const GLDMMatrix& matrix)
+{
+    if (!valid || matrix.empty())
+        return;
+
+    EntryHeader header{};
+    std::memcpy(header.magic, entryMagic, sizeof(entryMagic));
+    header.key = key;
+    header.grayLevels = matrix.grayLevels();
+    header.dependenceSizes = matrix.dependenceSizes();
+    const size_t countBytes = static_cast<size_t>(header.grayLevels) * header.dependenceSizes * sizeof(uint32_t);
+
+    const EntryId id = key.digest();
+    const std::filesystem::path path = entryPath(id);
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+    // Readers never see a half-written entry: the file appears under its final name only once complete.
+    const std::filesystem::path temporary = path.parent_path() / (path.filename().string() + temporarySuffix());
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(matrix.data()), static_cast<std::streamsize>(countBytes));
+        if (!file) {
+            std::cerr << "Could not write the cache entry: " << temporary.string() << std::endl;
+            file.close();
+            std::filesystem::remove(temporary, error);
+            return;
+        }
+    }
+
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        return;
+    }
+
+    std::lock_guard lock(mutex);
+    touch(id, sizeof(EntryHeader) + countBytes);
+    evict();
+}
+
+uint64_t GLDMCache::sizeBytes() const
+{
+    std::lock_guard lock(mutex);
+    return totalBytes;
+}
+
+void GLDMCache::touch(const EntryId& id, uint64_t size)
+{
+    auto it = entries.find(id);
+    if (it == entries.end()) {
+        recency.push_front(id);
+        entries[id] = { recency.begin(), size };
+        totalBytes += size;
+        return;
+    }
+    recency.splice(recency.begin(), recency, it->second.position);
+    totalBytes = totalBytes - it->second.size + size;
+    it->second.size = size;
+}
+
+void GLDMCache::forget(const EntryId& id)
+{
+    const auto it = entries.find(id);
+    if (it == entries.end())
+        return;
+    totalBytes -= it->second.size;
+    recency.erase(it->second.position);
+    entries.erase(it);
+}
+
+void GLDMCache::evict()
+{
+    // The most recent entry is always kept, even when it alone exceeds the limit.
+    while (maxBytes > 0 && totalBytes > maxBytes && recency.size() > 1) {
+        const EntryId id = recency.back();
+        forget(id);
+
+        std::error_code error;
+        std::filesystem::remove(entryPath(id), error);
+    }
+}
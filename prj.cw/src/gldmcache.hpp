@@ -0,0 +1,149 @@
+#pragma once
+
+#ifndef GLDMCache_2025
+#define GLDMCache_2025
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "gldm.hpp"
+
+namespace misis
+{
+    /// \brief Ключ записи кэша: содержимое файла и параметры, от которых зависит матрица.
+    ///
+    /// alpha и delta хранятся в целочисленном виде (см. `kernels::Neighbourhood`), поэтому
+    /// значения, дающие одинаковую матрицу, попадают в одну запись.
+    struct GLDMCacheKey
+    {
+        uint64_t contentHash[2] = {}; ///< 128-битный хеш содержимого файла.
+        uint64_t fileSize = 0; ///< Размер файла в байтах.
+        int32_t radius = 0; ///< Радиус окна.
+        int32_t threshold = -1; ///< Порог разности уровней.
+        int32_t grayLevels = 0; ///< Число уровней серого Ng.
+        int32_t quantizationMode = 0; ///< Способ квантования.
+        int32_t binWidth = 0; ///< Ширина интервала квантования.
+        int32_t decodeReduction = 1; ///< Уменьшение сторон при декодировании: 1, 2, 4 или 8.
+
+        /// \brief Хеширует содержимое файла.
+        /// \param[in] path Путь к файлу.
+        /// \param[out] key Ключ с заполненными `contentHash` и `fileSize`.
+        /// \return `false`, если файл не удалось прочитать.
+        static bool fromFile(const std::filesystem::path& path, GLDMCacheKey& key);
+
+        /// \brief Возвращает ключ того же файла для других параметров GLDM.
+        /// \param[in] reduction Уменьшение сторон при декодировании (см. `GLDM::loadImage`).
+        [[nodiscard]] GLDMCacheKey withParameters(Real delta, Real alpha, const GLDMQuantization& quantization, int reduction = 1) const;
+
+        /// \brief Короткий идентификатор записи: хеш содержимого, размер файла и хеш параметров.
+        [[nodiscard]] std::array<uint64_t, 4> digest() const;
+
+        /// \brief Имя файла записи: `digest` в шестнадцатеричном виде.
+        [[nodiscard]] std::string fileName() const;
+
+        bool operator==(const GLDMCacheKey& other) const = default;
+    };
+
+    /// \brief Способ использования кэша матриц.
+    enum class CacheMode
+    {
+        Off, ///< Кэш не используется.
+        ReadWrite, ///< Готовые матрицы берутся из кэша, новые сохраняются.
+        Rebuild ///< Все матрицы считаются заново и перезаписывают записи кэша.
+    };
+
+    /// \brief Постоянный кэш матриц GLDM на диске с адресацией по содержимому.
+    ///
+    /// Каждая запись - отдельный файл с заголовком и счётчиками матрицы, который читается через
+    /// отображение в память. Файлы раскладываются по 256 подпапкам по первому байту идентификатора,
+    /// поэтому даже на миллионах записей ни одна папка не разрастается.
+    ///
+    /// Размер кэша ограничен: при превышении удаляются записи, к которым дольше всего не обращались.
+    /// Порядок обращений хранится только в памяти и в файле индекса `index.bin`, который читается
+    /// при открытии и записывается при закрытии кэша, поэтому попадание в кэш не меняет метаданные файлов,
+    /// а открытие не обходит папки. Если индекса нет (первый запуск или аварийное завершение),
+    /// он восстанавливается обходом подпапок, а порядок обращений начинается заново.
+    ///
+    /// Запись выполняется во временный файл с уникальным для процесса и потока именем и последующим
+    /// переименованием, поэтому кэш можно использовать из нескольких потоков и процессов. Каждый процесс
+    /// вытесняет только записи из своего индекса; индекс сохраняет процесс, закрывший кэш последним.
+    class GLDMCache final
+    {
+    public:
+        /// \brief Открывает или создаёт кэш.
+        /// \param[in] directory Папка кэша.
+        /// \param[in] maxBytes Наибольший размер кэша в байтах, 0 - без ограничения.
+        GLDMCache(const std::filesystem::path& directory, uint64_t maxBytes);
+
+        /// \brief Сохраняет индекс.
+        ~GLDMCache();
+
+        /// \brief Проверяет, что папку кэша удалось создать.
+        [[nodiscard]] bool isOpen() const;
+
+        /// \brief Ищет матрицу в кэше.
+        /// \param[in] key Ключ записи.
+        /// \param[out] matrix Матрица из кэша.
+        /// \return `true`, если запись найдена и не повреждена.
+        bool load(const GLDMCacheKey& key, GLDMMatrix& matrix);
+
+        /// \brief Сохраняет матрицу и удаляет старые записи сверх лимита.
+        /// \param[in] key Ключ записи.
+        /// \param[in] matrix Вычисленная матрица.
+        void store(const GLDMCacheKey& key, const GLDMMatrix& matrix);
+
+        /// \brief Текущий размер кэша в байтах.
+        [[nodiscard]] uint64_t sizeBytes() const;
+
+    private:
+        using EntryId = std::array<uint64_t, 4>; ///< `GLDMCacheKey::digest` записи.
+
+        /// \brief Хеш идентификатора для `entries`; идентификатор уже равномерно распределён.
+        struct EntryIdHash
+        {
+            size_t operator()(const EntryId& id) const { return static_cast<size_t>(id[0] ^ id[3]); }
+        };
+
+        /// \brief Путь к файлу записи в её подпапке.
+        [[nodiscard]] std::filesystem::path entryPath(const EntryId& id) const;
+
+        /// \brief Читает индекс, оставленный предыдущим запуском, и удаляет его с диска.
+        /// \return `false`, если индекса нет или он повреждён.
+        bool loadIndex();
+
+        /// \brief Восстанавливает индекс обходом подпапок.
+        void scanEntries();
+
+        /// \brief Записывает индекс от недавно использованных записей к давним.
+        void saveIndex() const;
+
+        /// \brief Отмечает запись как использованную последней. Вызывается под `mutex`.
+        void touch(const EntryId& id, uint64_t size);
+
+        /// \brief Убирает из индекса запись, файла которой больше нет. Вызывается под `mutex`.
+        void forget(const EntryId& id);
+
+        /// \brief Удаляет самые старые записи, пока размер превышает лимит. Вызывается под `mutex`.
+        void evict();
+
+        struct Entry
+        {
+            std::list<EntryId>::iterator position; ///< Место в списке `recency`.
+            uint64_t size = 0; ///< Размер файла записи.
+        };
+
+        std::filesystem::path directory; ///< Папка кэша.
+        uint64_t maxBytes = 0; ///< Лимит размера.
+        bool valid = false; ///< Папка доступна.
+        mutable std::mutex mutex; ///< Защищает индекс.
+        std::list<EntryId> recency; ///< Записи от недавно использованных к давним.
+        std::unordered_map<EntryId, Entry, EntryIdHash> entries; ///< Индекс записей.
+        uint64_t totalBytes = 0; ///< Суммарный размер записей.
+    };
+}
+
+#endif
@@ -0,0 +1,155 @@
+#include "gldmmatrix.hpp"
+#include "gldm.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace misis;
+
+namespace
+{
+    constexpr size_t weightTableSize = 4096; ///< Размер таблиц весов; для больших индексов вес считается на месте.
+
+    /// \brief Таблица `(k + 1)^2`.
+    constexpr std::array<double, weightTableSize> squaredWeights = [] {
+        std::array<double, weightTableSize> table{};
+        for (size_t k = 0; k < weightTableSize; ++k)
+            table[k] = (k + 1.0) * (k + 1.0);
+        return table;
+    }();
+
+    /// \brief Таблица `1 / (k + 1)^2`.
+    constexpr std::array<double, weightTableSize> inverseSquaredWeights = [] {
+        std::array<double, weightTableSize> table{};
+        for (size_t k = 0; k < weightTableSize; ++k)
+            table[k] = 1.0 / ((k + 1.0) * (k + 1.0));
+        return table;
+    }();
+
+    inline double squaredWeight(size_t k)
+    {
+        return k < weightTableSize ? squaredWeights[k] : (k + 1.0) * (k + 1.0);
+    }
+
+    inline double inverseSquaredWeight(size_t k)
+    {
+        return k < weightTableSize ? inverseSquaredWeights[k] : 1.0 / ((k + 1.0) * (k + 1.0));
+    }
+}
+
+GLDMMatrix::GLDMMatrix(int grayLevels, int maxDependence)
+    : Ng(grayLevels)
+    , Nd(maxDependence + 1)
+    , counts(static_cast<size_t>(grayLevels) * (maxDependence + 1), 0)
+    , rowSums(grayLevels, 0)
+    , colSums(maxDependence + 1, 0)
+{
+}
+
+void GLDMMatrix::reset(int grayLevels, int maxDependence)
+{
+    Ng = grayLevels;
+    Nd = maxDependence + 1;
+    counts.assign(static_cast<size_t>(grayLevels) * (maxDependence + 1), 0);
+    rowSums.assign(grayLevels, 0);
+    colSums.assign(maxDependence + 1, 0);
+    Nz = 0;
+}
+
+int GLDMMatrix::maxDependenceForRadius(int radius, int rows, int cols)
+{
+    const int64_t side = 2 * static_cast<int64_t>(std::max(radius, 0)) + 1;
+    const int64_t neighbours = std::min<int64_t>(side, std::max(rows, 1)) * std::min<int64_t>(side, std::max(cols, 1)) - 1;
+    return static_cast<int>(std::min<int64_t>(neighbours, std::numeric_limits<int>::max() - 1));
+}
+
+void GLDMMatrix::merge(const GLDMMatrix& other)
+{
+    CheckReturn_Void(Ng == other.Ng && Nd == other.Nd);
+    for (size_t bin = 0; bin < counts.size(); ++bin)
+        counts[bin] += other.counts[bin];
+}
+
+void GLDMMatrix::updateMarginals()
+{
+    std::fill(rowSums.begin(), rowSums.end(), 0);
+    std::fill(colSums.begin(), colSums.end(), 0);
+    Nz = 0;
+
+    for (int i = 0; i < Ng; ++i) {
+        const uint32_t* row = counts.data() + static_cast<size_t>(i) * Nd;
+        uint64_t rowSum = 0;
+        for (int j = 0; j < Nd; ++j) {
+            rowSum += row[j];
+            colSums[j] += row[j];
+        }
+        rowSums[i] = rowSum;
+        Nz += rowSum;
+    }
+}
+
+GLDMFeatureSet GLDMMatrix::computeAllFeatures() const
+{
+    GLDMFeatureSet features;
+    CheckReturn(Nz > 0, features);
+
+    const double total = static_cast<double>(Nz);
+    double grayMean = 0.0;
+    double dependenceMean = 0.0;
+
+    for (int i = 0; i < Ng; ++i) {
+        if (rowSums[i] == 0) continue;
+
+        const uint32_t* row = counts.data() + static_cast<size_t>(i) * Nd;
+        const double grayWeight = squaredWeight(i);
+        const double inverseGrayWeight = inverseSquaredWeight(i);
+
+        for (int j = 0; j < Nd; ++j) {
+            if (row[j] == 0) continue;
+
+            const double P = row[j];
+            const double dependenceWeight = squaredWeight(j);
+            const double inverseDependenceWeight = inverseSquaredWeight(j);
+
+            features.SDE += P * inverseDependenceWeight;
+            features.LDE += P * dependenceWeight;
+            features.LGLE += P * inverseGrayWeight;
+            features.HGLE += P * grayWeight;
+            features.SDLGLE += P * inverseGrayWeight * inverseDependenceWeight;
+            features.SDHGLE += P * grayWeight * inverseDependenceWeight;
+            features.LDLGLE += P * inverseGrayWeight * dependenceWeight;
+            features.LDHGLE += P * grayWeight * dependenceWeight;
+
+            grayMean += P * (i + 1.0);
+            dependenceMean += P * (j + 1.0);
+
+            const double p = P / total;
+            features.DE -= p * std::log2(p);
+        }
+    }
+
+    for (const uint64_t rowSum : rowSums)
+        features.GLN += static_cast<double>(rowSum) * static_cast<double>(rowSum);
+    for (const uint64_t colSum : colSums)
+        features.DN += static_cast<double>(colSum) * static_cast<double>(colSum);
+
+    features.SDE /= total;
+    features.LDE /= total;
+    features.LGLE /= total;
+    features.HGLE /= total;
+    features.SDLGLE /= total;
+    features.SDHGLE /= total;
+    features.LDLGLE /= total;
+    features.LDHGLE /= total;
+    features.GLN /= total;
+    features.DNN = features.DN / (total * total);
+    features.DN /= total;
+
+    // E[i^2] and E[j^2] are exactly HGLE and LDE, so both variances come out of the same pass.
+    grayMean /= total;
+    dependenceMean /= total;
+    features.GLV = std::max(features.HGLE - grayMean * grayMean, 0.0);
+    features.DV = std::max(features.LDE - dependenceMean * dependenceMean, 0.0);
+
+    return features;
+}
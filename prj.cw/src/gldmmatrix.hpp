@@ -0,0 +1,138 @@
+#pragma once
+
+#ifndef GLDMMatrix_2025
+#define GLDMMatrix_2025
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace misis
+{
+    /// \brief Полный набор признаков GLDM.
+    ///
+    /// Уровни серого `i` и размеры зависимости `j` нумеруются с единицы, как в классическом определении GLDM.
+    struct GLDMFeatureSet
+    {
+        double SDE = 0.0; ///< Small Dependence Emphasis.
+        double LDE = 0.0; ///< Large Dependence Emphasis.
+        double GLN = 0.0; ///< Gray Level Non-Uniformity.
+        double DN = 0.0; ///< Dependence Non-Uniformity.
+        double DNN = 0.0; ///< Dependence Non-Uniformity Normalized.
+        double GLV = 0.0; ///< Gray Level Variance.
+        double DV = 0.0; ///< Dependence Variance.
+        double DE = 0.0; ///< Dependence Entropy.
+        double LGLE = 0.0; ///< Low Gray Level Emphasis.
+        double HGLE = 0.0; ///< High Gray Level Emphasis.
+        double SDLGLE = 0.0; ///< Small Dependence Low Gray Level Emphasis.
+        double SDHGLE = 0.0; ///< Small Dependence High Gray Level Emphasis.
+        double LDLGLE = 0.0; ///< Large Dependence Low Gray Level Emphasis.
+        double LDHGLE = 0.0; ///< Large Dependence High Gray Level Emphasis.
+
+        /// \brief Число признаков в наборе.
+        static constexpr size_t size = 14;
+
+        /// \brief Короткие имена признаков в порядке `values()`.
+        static constexpr std::array<std::string_view, size> names = {
+            "SDE", "LDE", "GLN", "DN", "DNN", "GLV", "DV", "DE",
+            "LGLE", "HGLE", "SDLGLE", "SDHGLE", "LDLGLE", "LDHGLE"
+        };
+
+        /// \brief Значения признаков в порядке `names`.
+        [[nodiscard]] std::array<double, size> values() const
+        {
+            return { SDE, LDE, GLN, DN, DNN, GLV, DV, DE, LGLE, HGLE, SDLGLE, SDHGLE, LDLGLE, LDHGLE };
+        }
+    };
+
+    /// \brief Матрица зависимостей уровней серого P(i, j).
+    ///
+    /// Хранит целочисленные счётчики в непрерывном массиве размера `Ng x (maxDependence + 1)`:
+    /// строка `i` - уровень серого, столбец `j` - число зависимых соседей.
+    /// Суммы по строкам и столбцам и общее число пикселей Nz кешируются в `updateMarginals`,
+    /// чтобы признаки не пересчитывали их при каждом обращении.
+    class GLDMMatrix final
+    {
+    public:
+        /// \brief Конструктор по умолчанию. Создаёт пустую матрицу.
+        GLDMMatrix() = default;
+
+        /// \brief Создаёт нулевую матрицу.
+        /// \param[in] grayLevels Число уровней серого Ng.
+        /// \param[in] maxDependence Максимальное число зависимых соседей.
+        GLDMMatrix(int grayLevels, int maxDependence);
+
+        /// \brief Обнуляет матрицу и задаёт её размер, сохраняя уже выделенную память.
+        /// \param[in] grayLevels Число уровней серого Ng.
+        /// \param[in] maxDependence Максимальное число зависимых соседей.
+        void reset(int grayLevels, int maxDependence);
+
+        /// \brief Максимальное число зависимых соседей для окна радиуса delta в изображении `rows x cols`.
+        ///
+        /// Окно обрезается границами изображения: `min(2 * delta + 1, rows) * min(2 * delta + 1, cols) - 1`.
+        /// Считается в 64 битах и ограничивается `INT_MAX - 1`, поэтому не переполняется при любом радиусе.
+        static int maxDependenceForRadius(int radius, int rows, int cols);
+
+        /// \brief Наибольшее число ячеек `Ng x (maxDependence + 1)`, которое разрешено выделять (1 ГиБ счётчиков).
+        static constexpr size_t maxCells = size_t(1) << 28;
+
+        /// \brief Наибольшее число пикселей изображения: счётчики 32-битные, и в одну ячейку может попасть каждый пиксель.
+        static constexpr uint64_t maxPixels = 0xFFFFFFFFull;
+
+        /// \brief Проверяет, что матрица не пуста.
+        [[nodiscard]] bool empty() const { return counts.empty(); }
+
+        /// \brief Число уровней серого Ng (строк матрицы).
+        [[nodiscard]] int grayLevels() const { return Ng; }
+
+        /// \brief Максимальное число зависимых соседей.
+        [[nodiscard]] int maxDependence() const { return Nd - 1; }
+
+        /// \brief Число столбцов матрицы (`maxDependence + 1`).
+        [[nodiscard]] int dependenceSizes() const { return Nd; }
+
+        /// \brief Значение P(i, j).
+        [[nodiscard]] uint32_t at(int i, int j) const { return counts[static_cast<size_t>(i) * Nd + j]; }
+
+        /// \brief Указатель на непрерывный массив счётчиков (построчно).
+        [[nodiscard]] uint32_t* data() { return counts.data(); }
+
+        /// \brief Указатель на непрерывный массив счётчиков (построчно).
+        [[nodiscard]] const uint32_t* data() const { return counts.data(); }
+
+        /// \brief Прибавляет счётчики другой матрицы того же размера.
+        void merge(const GLDMMatrix& other);
+
+        /// \brief Пересчитывает кешированные суммы по строкам, столбцам и Nz.
+        ///
+        /// Должна вызываться после заполнения счётчиков через `data()` или `merge`.
+        void updateMarginals();
+
+        /// \brief Суммы по строкам: число пикселей каждого уровня серого.
+        [[nodiscard]] const std::vector<uint64_t>& grayLevelSums() const { return rowSums; }
+
+        /// \brief Суммы по столбцам: число пикселей с каждым числом зависимых соседей.
+        [[nodiscard]] const std::vector<uint64_t>& dependenceSums() const { return colSums; }
+
+        /// \brief Общее число учтённых пикселей Nz.
+        [[nodiscard]] uint64_t totalCount() const { return Nz; }
+
+        /// \brief Вычисляет все признаки GLDM за один проход по матрице.
+        ///
+        /// Веса `1/i^2`, `i^2`, `1/j^2`, `j^2` берутся из таблиц, посчитанных при компиляции.
+        /// Признаки неоднородности используют кешированные суммы, поэтому `updateMarginals` должна быть вызвана заранее.
+        [[nodiscard]] GLDMFeatureSet computeAllFeatures() const;
+
+    private:
+        int Ng = 0; ///< Число уровней серого.
+        int Nd = 0; ///< Число столбцов (maxDependence + 1).
+        std::vector<uint32_t> counts; ///< Счётчики P(i, j), построчно.
+        std::vector<uint64_t> rowSums; ///< Кешированные суммы по строкам.
+        std::vector<uint64_t> colSums; ///< Кешированные суммы по столбцам.
+        uint64_t Nz = 0; ///< Кешированная сумма всех счётчиков.
+    };
+}
+
+#endif
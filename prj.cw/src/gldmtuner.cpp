@@ -0,0 +1,121 @@
+#include "gldmtuner.hpp"
+#include "kernels.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+
+using namespace misis;
+
+GLDMTuner::GLDMTuner(size_t memoryLimit)
+    : memoryLimit(memoryLimit)
+{
+}
+
+bool GLDMTuner::setImage(const cv::Mat& image, const GLDMQuantization& levelsQuantization)
+{
+    GLDM_PROFILE_SCOPE("GLDMTuner::setImage");
+    levels.release();
+    planes.clear();
+    builtRadius = 0;
+
+    GLDM gldm;
+    CheckReturn(gldm.setQuantization(levelsQuantization), false);
+    CheckReturn(!image.empty() && gldm.importImageFromMat(image), false);
+    quantization = levelsQuantization;
+    levels = gldm.computeLevelImage();
+    GLDM_PROFILE_PIXELS(levels.total());
+
+    // The window of radius R needs 2R(R + 1) planes, none of them larger than the image.
+    // An image too large even for radius 1 keeps the limit at 0 and is not tuned live.
+    const size_t planeBytes = levels.total() * levels.elemSize();
+    const int largestWindow = std::max({ levels.rows, levels.cols, 1 });
+    radiusLimit = 0;
+    while (radiusLimit < largestWindow
+        && 2 * static_cast<size_t>(radiusLimit + 1) * (radiusLimit + 2) * planeBytes <= memoryLimit)
+        ++radiusLimit;
+    return true;
+}
+
+void GLDMTuner::buildPlanes(int radius)
+{
+    for (int ring = builtRadius + 1; ring <= radius; ++ring) {
+        // Half of the ring: every neighbour in the rows below and the right one in the same row.
+        for (int dy = 0; dy <= ring; ++dy) {
+            for (int dx = -ring; dx <= ring; ++dx) {
+                if (std::max(dy, std::abs(dx)) != ring || (dy == 0 && dx <= 0))
+                    continue;
+                Plane plane{ dy, dx, std::max(0, -dx), cv::Mat() };
+                const int width = levels.cols - std::abs(dx);
+                const int height = levels.rows - dy;
+                // Offsets that leave the image keep an empty plane, so a window is always a prefix of the list.
+                if (width > 0 && height > 0)
+                    cv::absdiff(levels(cv::Rect(plane.x0, 0, width, height)),
+                        levels(cv::Rect(plane.x0 + dx, dy, width, height)), plane.diff);
+                planes.push_back(std::move(plane));
+            }
+        }
+    }
+    builtRadius = std::max(builtRadius, radius);
+}
+
+template <typename Level>
+GLDMMatrix GLDMTuner::accumulate(size_t planeCount, int maxDependence, int threshold, int threads) const
+{
+    // Each band owns a private matrix, as in GLDM::computeMatrix, so the result does not depend on the thread count.
+    const int bandCount = GLDM::partialBands(threads, levels.rows,
+        static_cast<size_t>(quantization.grayLevels) * (static_cast<size_t>(maxDependence) + 1));
+    std::vector<GLDMMatrix> partials(bandCount, GLDMMatrix(quantization.grayLevels, maxDependence));
+
+    cv::parallel_for_(cv::Range(0, bandCount), [&](const cv::Range& range) {
+        std::vector<ushort> counts(levels.cols);
+        for (int band = range.start; band < range.end; ++band) {
+            const int yBegin = static_cast<int>(static_cast<int64_t>(levels.rows) * band / bandCount);
+            const int yEnd = static_cast<int>(static_cast<int64_t>(levels.rows) * (band + 1) / bandCount);
+            uint32_t* histogram = partials[band].data();
+
+            for (int y = yBegin; y < yEnd; ++y) {
+                std::fill(counts.begin(), counts.end(), ushort(0));
+                for (size_t p = 0; p < planeCount; ++p) {
+                    const Plane& plane = planes[p];
+                    if (plane.diff.empty())
+                        continue;
+                    // The pixel compared with its neighbour at (dy, dx)...
+                    if (y < plane.diff.rows)
+                        kernels::countWithinThreshold(plane.diff.ptr<Level>(y), plane.diff.cols, threshold,
+                            counts.data() + plane.x0);
+                    // ...and the same difference seen from the neighbour, which sits dy rows above it.
+                    if (y >= plane.dy)
+                        kernels::countWithinThreshold(plane.diff.ptr<Level>(y - plane.dy), plane.diff.cols, threshold,
+                            counts.data() + plane.x0 + plane.dx);
+                }
+
+                const Level* center = levels.ptr<Level>(y);
+                for (int x = 0; x < levels.cols; ++x)
+                    histogram[static_cast<size_t>(center[x]) * (maxDependence + 1) + counts[x]]++;
+            }
+        }
+    }, bandCount);
+
+    GLDMMatrix result = std::move(partials[0]);
+    for (int band = 1; band < bandCount; ++band)
+        result.merge(partials[band]);
+    result.updateMarginals();
+    return result;
+}
+
+GLDMMatrix GLDMTuner::computeMatrix(Real delta, Real alpha, int threads)
+{
+    CheckReturn(isReady(), GLDMMatrix());
+    const kernels::Neighbourhood hood = kernels::makeNeighbourhood(delta, alpha, std::max(levels.rows, levels.cols));
+    CheckReturn(hood.radius <= radiusLimit, GLDMMatrix());
+    GLDM_PROFILE_SCOPE("GLDMTuner::computeMatrix");
+    GLDM_PROFILE_PIXELS(levels.total());
+
+    buildPlanes(hood.radius);
+    // Planes are stored ring by ring, so the window of radius r is exactly the first 2r(r + 1) of them.
+    const size_t planeCount = hood.threshold < 0 ? 0 : 2 * static_cast<size_t>(hood.radius) * (hood.radius + 1);
+    const int maxDependence = GLDMMatrix::maxDependenceForRadius(hood.radius, levels.rows, levels.cols);
+    CheckReturn(static_cast<size_t>(quantization.grayLevels) * (static_cast<size_t>(maxDependence) + 1) <= GLDMMatrix::maxCells, GLDMMatrix());
+    if (levels.depth() == CV_8U)
+        return accumulate<uchar>(planeCount, maxDependence, hood.threshold, threads);
+    return accumulate<ushort>(planeCount, maxDependence, hood.threshold, threads);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#ifndef GLDMTuner_2025
+#define GLDMTuner_2025
+
+#include "gldm.hpp"
+#include <vector>
+
+namespace misis
+{
+    /// \brief Быстрый пересчёт GLDM одного изображения при подборе alpha и delta.
+    ///
+    /// Для каждого смещения соседа один раз считается плоскость модулей разностей уровней серого.
+    /// Разность симметрична, поэтому хранится только половина смещений окна: плоскость смещения
+    /// `(dy, dx)` засчитывается и пикселю, и его соседу. После этого смена alpha - одно сравнение
+    /// на пиксель и смещение, без повторного обхода изображения и квантования. Плоскости добавляются
+    /// кольцами по мере роста delta, поэтому первый запрос с меньшим delta не платит за большие окна.
+    /// Матрица совпадает с `GLDM::computeMatrix` при тех же параметрах.
+    class GLDMTuner final
+    {
+    public:
+        /// \param[in] memoryLimit Наибольший объём плоскостей разностей в байтах; ограничивает delta.
+        explicit GLDMTuner(size_t memoryLimit = size_t(256) << 20);
+
+        /// \brief Квантует изображение и сбрасывает плоскости предыдущего.
+        /// \param[in] image Изображение; цветное переводится в оттенки серого (см. `GLDM::importImageFromMat`).
+        /// \param[in] quantization Параметры квантования.
+        /// \return `false`, если изображение пустое или параметры некорректны.
+        bool setImage(const cv::Mat& image, const GLDMQuantization& quantization = {});
+
+        /// \brief Проверяет, что изображение задано.
+        [[nodiscard]] bool isReady() const { return !levels.empty(); }
+
+        /// \brief Наибольший радиус, плоскости которого помещаются в `memoryLimit`.
+        ///
+        /// 0, если не помещается даже радиус 1: такое изображение пересчитывать на лету нельзя.
+        [[nodiscard]] int maxRadius() const { return radiusLimit; }
+
+        /// \brief Вычисляет матрицу для заданных параметров.
+        /// \param[in] delta Радиус поиска соседей, не больше `maxRadius`.
+        /// \param[in] alpha Порог разности уровней серого.
+        /// \param[in] threads Число потоков (0 - все ядра).
+        /// \return Матрица зависимостей; пустая, если изображение не задано или delta больше `maxRadius`.
+        [[nodiscard]] GLDMMatrix computeMatrix(Real delta, Real alpha, int threads = 1);
+
+    private:
+        /// \brief Модули разностей уровней пикселя и соседа на смещении `(dy, dx)`.
+        struct Plane
+        {
+            int dy = 0; ///< Смещение соседа по вертикали, не меньше 0.
+            int dx = 0; ///< Смещение соседа по горизонтали.
+            int x0 = 0; ///< Столбец изображения, с которого начинаются строки `diff`.
+            cv::Mat diff; ///< Разности для пикселей, у которых сосед внутри изображения.
+        };
+
+        /// \brief Досчитывает плоскости колец до радиуса `radius` включительно.
+        void buildPlanes(int radius);
+
+        /// \brief Накапливает матрицу по первым `planeCount` плоскостям.
+        template <typename Level>
+        GLDMMatrix accumulate(size_t planeCount, int maxDependence, int threshold, int threads) const;
+
+        size_t memoryLimit; ///< Наибольший объём плоскостей в байтах.
+        GLDMQuantization quantization; ///< Параметры квантования текущего изображения.
+        cv::Mat levels; ///< Уровни серого изображения (`GLDM::computeLevelImage`).
+        std::vector<Plane> planes; ///< Плоскости в порядке колец.
+        int builtRadius = 0; ///< Радиус, до которого плоскости посчитаны.
+        int radiusLimit = 0; ///< Наибольший допустимый радиус.
+    };
+}
+
+#endif
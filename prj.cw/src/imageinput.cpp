@@ -0,0 +1,43 @@
+#include "imageinput.hpp"
+#include "rowsource.hpp"
+#include <limits>
+#include <opencv2/imgcodecs.hpp>
+
+using namespace misis;
+
+bool misis::reusableImageBuffer(const cv::Mat& image)
+{
+    return image.u != nullptr && image.u->refcount == 1;
+}
+
+bool misis::readMappedImage(const std::filesystem::path& path, int flags, cv::Mat& image, std::shared_ptr<const MappedFile>& mapping)
+{
+    if (!reusableImageBuffer(image))
+        image.release();
+    mapping.reset();
+
+    auto file = std::make_shared<const MappedFile>(path);
+    if (!file->isOpen() || file->size() == 0) {
+        image.release();
+        return false;
+    }
+
+    PgmHeader header;
+    const bool fullResolution = (flags & ~cv::IMREAD_ANYDEPTH) == cv::IMREAD_GRAYSCALE;
+    if (fullResolution && parsePgmHeader(file->data(), file->size(), header) && header.maxValue <= 255
+        && file->size() - header.dataOffset >= static_cast<size_t>(header.width) * header.height) {
+        // The pixel rows of an 8-bit PGM are already laid out as a continuous CV_8U matrix.
+        image = cv::Mat(header.height, header.width, CV_8U, const_cast<uint8_t*>(file->data() + header.dataOffset));
+        mapping = std::move(file);
+        return true;
+    }
+
+    // imdecode takes the encoded bytes as a single row, whose length is an int.
+    if (file->size() > static_cast<size_t>(std::numeric_limits<int>::max())) {
+        image = cv::imread(path.string(), flags);
+        return !image.empty();
+    }
+    if (cv::imdecode(cv::Mat(1, static_cast<int>(file->size()), CV_8U, const_cast<uint8_t*>(file->data())), flags, &image).empty())
+        image.release();
+    return !image.empty();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#ifndef GLDMImageInput_2025
+#define GLDMImageInput_2025
+
+#include <filesystem>
+#include <memory>
+#include <opencv2/core.hpp>
+#include "mappedfile.hpp"
+
+namespace misis
+{
+    /// \brief Проверяет, что `cv::imdecode` может декодировать поверх `image` без новой памяти.
+    ///
+    /// Подходит только буфер, которым `image` владеет единолично: пиксели в отображении файла
+    /// или в матрице, на которую ссылается кто-то ещё (например, результат анализа), перезаписывать нельзя.
+    bool reusableImageBuffer(const cv::Mat& image);
+
+    /// \brief Читает изображение через отображение файла в память.
+    ///
+    /// 8-битный бинарный PGM не декодируется вовсе: `image` указывает прямо на пиксели в
+    /// отображении, которое удерживает `mapping`. Остальные форматы декодируются `cv::imdecode`
+    /// прямо из отображения, без промежуточного буфера, который заполняет `cv::imread`.
+    /// \param[in] path Путь к изображению.
+    /// \param[in] flags Флаги `cv::IMREAD_*`; без сжатия (`IMREAD_REDUCED_*`) PGM читается без копирования.
+    /// \param[in,out] image Изображение. Прежний буфер используется повторно, если это позволяет `reusableImageBuffer`.
+    ///                     Если `mapping` не пуст, данные доступны только для чтения.
+    /// \param[out] mapping Отображение, в которое указывает `image`, или `nullptr`, если изображение декодировано.
+    /// \return `false`, если файл не удалось прочитать или декодировать.
+    bool readMappedImage(const std::filesystem::path& path, int flags, cv::Mat& image, std::shared_ptr<const MappedFile>& mapping);
+}
+
+#endif
@@ -0,0 +1,363 @@
+#include "kernels.hpp"
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <utility>
+
+using namespace misis;
+
+namespace
+{
+    /// \brief Считает зависимых соседей одного пикселя с проверкой границ.
+    template <typename Level>
+    int countPixel(const Level* const* rows, int cols, const kernels::Neighbourhood& hood, int x)
+    {
+        const int r = hood.radius;
+        const int centerVal = rows[r][x];
+        const int xBegin = std::max(x - r, 0);
+        const int xEnd = std::min(x + r, cols - 1);
+        int count = 0;
+
+        for (int k = 0; k <= 2 * r; ++k) {
+            const Level* row = rows[k];
+            if (!row) continue;
+            for (int nx = xBegin; nx <= xEnd; ++nx) {
+                if (k == r && nx == x) continue;
+                if (std::abs(centerVal - row[nx]) <= hood.threshold)
+                    count++;
+            }
+        }
+        return count;
+    }
+
+    /// \brief Смещение соседа относительно центрального пикселя.
+    struct Offset
+    {
+        int dy;
+        int dx;
+    };
+
+    /// \brief Таблица смещений окна радиуса `R` без центрального пикселя, построенная при компиляции.
+    template <int R>
+    constexpr std::array<Offset, (2 * R + 1) * (2 * R + 1) - 1> offsetTable = [] {
+        std::array<Offset, (2 * R + 1) * (2 * R + 1) - 1> table{};
+        size_t i = 0;
+        for (int dy = -R; dy <= R; ++dy)
+            for (int dx = -R; dx <= R; ++dx)
+                if (dy != 0 || dx != 0)
+                    table[i++] = { dy, dx };
+        return table;
+    }();
+
+    template <int R, typename Level, size_t... I>
+    inline int countPixelFixed(const Level* const* rows, int x, int threshold, std::index_sequence<I...>)
+    {
+        const int centerVal = rows[R][x];
+        return (0 + ... + static_cast<int>(
+            std::abs(centerVal - rows[R + offsetTable<R>[I].dy][x + offsetTable<R>[I].dx]) <= threshold));
+    }
+
+#if CV_SIMD128
+    /// \brief Векторные типы и операции для уровней серого типа `Level`.
+    template <typename Level>
+    struct SimdTraits;
+
+    template <>
+    struct SimdTraits<uchar>
+    {
+        using Vec = cv::v_uint8x16;
+        static constexpr int lanes = cv::v_uint8x16::nlanes;
+
+        static Vec all(int value) { return cv::v_setall_u8(static_cast<uchar>(std::clamp(value, 0, 255))); }
+        static Vec zero() { return cv::v_setzero_u8(); }
+
+        /// \brief Расширяет 8-битные счётчики до `int` и сохраняет их.
+        static void store(const Vec& acc, int* counts)
+        {
+            cv::v_uint16x8 lo, hi;
+            cv::v_expand(acc, lo, hi);
+            cv::v_uint32x4 q0, q1, q2, q3;
+            cv::v_expand(lo, q0, q1);
+            cv::v_expand(hi, q2, q3);
+            unsigned* out = reinterpret_cast<unsigned*>(counts);
+            cv::v_store(out, q0);
+            cv::v_store(out + 4, q1);
+            cv::v_store(out + 8, q2);
+            cv::v_store(out + 12, q3);
+        }
+    };
+
+    template <>
+    struct SimdTraits<ushort>
+    {
+        using Vec = cv::v_uint16x8;
+        static constexpr int lanes = cv::v_uint16x8::nlanes;
+
+        static Vec all(int value) { return cv::v_setall_u16(static_cast<ushort>(std::clamp(value, 0, 65535))); }
+        static Vec zero() { return cv::v_setzero_u16(); }
+
+        /// \brief Расширяет 16-битные счётчики до `int` и сохраняет их.
+        static void store(const Vec& acc, int* counts)
+        {
+            cv::v_uint32x4 lo, hi;
+            cv::v_expand(acc, lo, hi);
+            unsigned* out = reinterpret_cast<unsigned*>(counts);
+            cv::v_store(out, lo);
+            cv::v_store(out + 4, hi);
+        }
+    };
+
+    template <int R, typename Level, size_t... I>
+    inline typename SimdTraits<Level>::Vec countBlockFixed(const Level* const* rows, int x,
+        const typename SimdTraits<Level>::Vec& vThreshold, const typename SimdTraits<Level>::Vec& vOne, std::index_sequence<I...>)
+    {
+        using Traits = SimdTraits<Level>;
+        const typename Traits::Vec c = cv::v_load(rows[R] + x);
+        typename Traits::Vec acc = Traits::zero();
+        ((acc += (cv::v_absdiff(c, cv::v_load(rows[R + offsetTable<R>[I].dy] + x + offsetTable<R>[I].dx)) <= vThreshold) & vOne), ...);
+        return acc;
+    }
+#endif
+
+    /// \brief Ядро с радиусом окна, известным при компиляции.
+    ///
+    /// Строки, у которых окно целиком внутри изображения, считаются развёрнутым циклом без ветвлений.
+    /// Первые и последние `R` строк и столбцов передаются универсальному коду.
+    template <int R, typename Level>
+    void countRowFixed(const Level* const* rows, int cols, const kernels::Neighbourhood& hood, int* counts)
+    {
+        bool fullWindow = hood.threshold >= 0 && hood.radius == R;
+        for (int k = 0; k <= 2 * R; ++k)
+            fullWindow = fullWindow && rows[k] != nullptr;
+        if (!fullWindow) {
+            kernels::countRowSimd(rows, cols, hood, counts);
+            return;
+        }
+
+        constexpr auto offsets = std::make_index_sequence<offsetTable<R>.size()>{};
+        const int interiorEnd = cols - R;
+        int x = R;
+#if CV_SIMD128
+        using Traits = SimdTraits<Level>;
+        const typename Traits::Vec vThreshold = Traits::all(hood.threshold);
+        const typename Traits::Vec vOne = Traits::all(1);
+        for (; x + Traits::lanes <= interiorEnd; x += Traits::lanes)
+            Traits::store(countBlockFixed<R>(rows, x, vThreshold, vOne, offsets), counts + x);
+#endif
+        for (; x < interiorEnd; ++x)
+            counts[x] = countPixelFixed<R>(rows, x, hood.threshold, offsets);
+
+        for (int bx = 0; bx < std::min(R, cols); ++bx)
+            counts[bx] = countPixel(rows, cols, hood, bx);
+        for (int bx = std::max(interiorEnd, R); bx < cols; ++bx)
+            counts[bx] = countPixel(rows, cols, hood, bx);
+    }
+
+    /// \brief Скалярный подсчёт для режима перебора параметров в одном пикселе с проверкой границ.
+    template <typename Level>
+    void countPixelSweep(const Level* const* rows, int cols, int R, const std::vector<int>& thresholds,
+        const std::vector<int>& radii, int x, int* counts)
+    {
+        const size_t A = thresholds.size();
+        const size_t D = radii.size();
+        const int centerVal = rows[R][x];
+
+        for (size_t cell = 0; cell < A * D; ++cell)
+            counts[cell * cols + x] = 0;
+
+        for (int dy = -R; dy <= R; ++dy) {
+            const Level* row = rows[R + dy];
+            if (!row) continue;
+            for (int dx = -R; dx <= R; ++dx) {
+                const int nx = x + dx;
+                if ((dx == 0 && dy == 0) || nx < 0 || nx >= cols) continue;
+
+                const int ring = std::max(std::abs(dx), std::abs(dy));
+                const int diff = std::abs(centerVal - row[nx]);
+                for (size_t a = 0; a < A; ++a) {
+                    if (diff > thresholds[a]) continue;
+                    for (size_t d = 0; d < D; ++d)
+                        counts[(a * D + d) * cols + x] += radii[d] >= ring;
+                }
+            }
+        }
+    }
+}
+
+kernels::Neighbourhood kernels::makeNeighbourhood(float delta, float alpha, int extent)
+{
+    Neighbourhood hood;
+    if (delta >= 1.0f)
+        hood.radius = static_cast<int>(std::min<double>(std::floor(delta), std::max(extent - 1, 0)));
+    if (alpha >= 0.0f)
+        hood.threshold = static_cast<int>(std::min<double>(std::floor(alpha), 65535.0));
+    return hood;
+}
+
+bool kernels::isSimdAvailable(int radius)
+{
+#if CV_SIMD128
+    const int64_t side = 2 * static_cast<int64_t>(radius) + 1;
+    return side * side - 1 <= 255;
+#else
+    (void)radius;
+    return false;
+#endif
+}
+
+template <typename Level>
+void kernels::countRowScalar(const Level* const* rows, int cols, const Neighbourhood& hood, int* counts)
+{
+    if (hood.threshold < 0 || hood.radius == 0) {
+        std::fill(counts, counts + cols, 0);
+        return;
+    }
+    for (int x = 0; x < cols; ++x)
+        counts[x] = countPixel(rows, cols, hood, x);
+}
+
+template <typename Level>
+void kernels::countRowSimd(const Level* const* rows, int cols, const Neighbourhood& hood, int* counts)
+{
+#if CV_SIMD128
+    const int r = hood.radius;
+    if (hood.threshold < 0 || r == 0 || !isSimdAvailable(r)) {
+        countRowScalar(rows, cols, hood, counts);
+        return;
+    }
+
+    using Traits = SimdTraits<Level>;
+    const Level* center = rows[r];
+    const typename Traits::Vec vThreshold = Traits::all(hood.threshold);
+    const typename Traits::Vec vOne = Traits::all(1);
+
+    // Every horizontal offset of a pixel in [r, cols - r) stays inside the row,
+    // so the hot loop below needs no bounds checks at all.
+    const int interiorEnd = cols - r;
+    int x = r;
+    for (; x + Traits::lanes <= interiorEnd; x += Traits::lanes) {
+        const typename Traits::Vec c = cv::v_load(center + x);
+        typename Traits::Vec acc = Traits::zero();
+
+        for (int k = 0; k <= 2 * r; ++k) {
+            const Level* row = rows[k];
+            if (!row) continue;
+            for (int dx = -r; dx <= r; ++dx) {
+                if (k == r && dx == 0) continue;
+                const typename Traits::Vec diff = cv::v_absdiff(c, cv::v_load(row + x + dx));
+                acc += (diff <= vThreshold) & vOne;
+            }
+        }
+
+        Traits::store(acc, counts + x);
+    }
+
+    for (int bx = 0; bx < std::min(r, cols); ++bx)
+        counts[bx] = countPixel(rows, cols, hood, bx);
+    for (; x < cols; ++x)
+        counts[x] = countPixel(rows, cols, hood, x);
+#else
+    countRowScalar(rows, cols, hood, counts);
+#endif
+}
+
+template <typename Level>
+kernels::RowKernel<Level> kernels::specializedRowKernel(int radius)
+{
+    switch (radius) {
+    case 1: return &countRowFixed<1, Level>;
+    case 2: return &countRowFixed<2, Level>;
+    case 3: return &countRowFixed<3, Level>;
+    default: return nullptr;
+    }
+}
+
+template <typename Level>
+void kernels::countRowSweep(const Level* const* rows, int cols, const std::vector<int>& thresholds,
+    const std::vector<int>& radii, int* counts)
+{
+    const int R = radii.empty() ? 0 : *std::max_element(radii.begin(), radii.end());
+    const size_t A = thresholds.size();
+    const size_t D = radii.size();
+    int x = 0;
+
+#if CV_SIMD128
+    if (R > 0 && isSimdAvailable(R)) {
+        using Traits = SimdTraits<Level>;
+        const typename Traits::Vec vOne = Traits::all(1);
+        std::vector<typename Traits::Vec> vThresholds(A);
+        for (size_t a = 0; a < A; ++a)
+            vThresholds[a] = Traits::all(thresholds[a]);
+        std::vector<typename Traits::Vec> acc(A * D);
+
+        x = R;
+        for (; x + Traits::lanes <= cols - R; x += Traits::lanes) {
+            const typename Traits::Vec c = cv::v_load(rows[R] + x);
+            std::fill(acc.begin(), acc.end(), Traits::zero());
+
+            for (int dy = -R; dy <= R; ++dy) {
+                const Level* row = rows[R + dy];
+                if (!row) continue;
+                for (int dx = -R; dx <= R; ++dx) {
+                    if (dx == 0 && dy == 0) continue;
+                    const int ring = std::max(std::abs(dx), std::abs(dy));
+                    const typename Traits::Vec diff = cv::v_absdiff(c, cv::v_load(row + x + dx));
+                    for (size_t a = 0; a < A; ++a) {
+                        if (thresholds[a] < 0) continue;
+                        const typename Traits::Vec hit = (diff <= vThresholds[a]) & vOne;
+                        for (size_t d = 0; d < D; ++d)
+                            if (radii[d] >= ring)
+                                acc[a * D + d] += hit;
+                    }
+                }
+            }
+
+            for (size_t cell = 0; cell < A * D; ++cell)
+                Traits::store(acc[cell], counts + cell * cols + x);
+        }
+
+        for (int bx = 0; bx < std::min(R, cols); ++bx)
+            countPixelSweep(rows, cols, R, thresholds, radii, bx, counts);
+    }
+#endif
+
+    for (; x < cols; ++x)
+        countPixelSweep(rows, cols, R, thresholds, radii, x, counts);
+}
+
+template <typename Level>
+void kernels::countWithinThreshold(const Level* diffs, int cols, int threshold, ushort* counts)
+{
+    int x = 0;
+#if CV_SIMD128
+    using Traits = SimdTraits<Level>;
+    const typename Traits::Vec vThreshold = Traits::all(threshold);
+    const typename Traits::Vec vOne = Traits::all(1);
+    for (; x + Traits::lanes <= cols; x += Traits::lanes) {
+        const typename Traits::Vec hit = (cv::v_load(diffs + x) <= vThreshold) & vOne;
+        if constexpr (sizeof(Level) == 1) {
+            cv::v_uint16x8 lo, hi;
+            cv::v_expand(hit, lo, hi);
+            cv::v_store(counts + x, cv::v_load(counts + x) + lo);
+            cv::v_store(counts + x + 8, cv::v_load(counts + x + 8) + hi);
+        }
+        else {
+            cv::v_store(counts + x, cv::v_load(counts + x) + hit);
+        }
+    }
+#endif
+    for (; x < cols; ++x)
+        counts[x] += diffs[x] <= threshold;
+}
+
+template void kernels::countRowScalar<uchar>(const uchar* const*, int, const Neighbourhood&, int*);
+template void kernels::countRowScalar<ushort>(const ushort* const*, int, const Neighbourhood&, int*);
+template void kernels::countRowSimd<uchar>(const uchar* const*, int, const Neighbourhood&, int*);
+template void kernels::countRowSimd<ushort>(const ushort* const*, int, const Neighbourhood&, int*);
+template kernels::RowKernel<uchar> kernels::specializedRowKernel<uchar>(int);
+template kernels::RowKernel<ushort> kernels::specializedRowKernel<ushort>(int);
+template void kernels::countRowSweep<uchar>(const uchar* const*, int, const std::vector<int>&, const std::vector<int>&, int*);
+template void kernels::countRowSweep<ushort>(const ushort* const*, int, const std::vector<int>&, const std::vector<int>&, int*);
+template void kernels::countWithinThreshold<uchar>(const uchar*, int, int, ushort*);
+template void kernels::countWithinThreshold<ushort>(const ushort*, int, int, ushort*);
@@ -0,0 +1,87 @@
+#pragma once
+
+#ifndef GLDMKernels_2025
+#define GLDMKernels_2025
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+namespace misis::kernels
+{
+    /// \brief Целочисленные параметры окрестности, эквивалентные вещественным alpha и delta.
+    ///
+    /// Разность уровней серого всегда целая, поэтому условие `|a - b| <= alpha` равносильно
+    /// `|a - b| <= floor(alpha)`, а цикл `for (int dy = -delta; dy <= delta; ++dy)` обходит
+    /// ровно смещения `[-floor(delta), floor(delta)]`.
+    struct Neighbourhood
+    {
+        int radius = 0; ///< Радиус окна (0 - соседей нет).
+        int threshold = -1; ///< Порог разности уровней (-1 - ни один сосед не зависим).
+    };
+
+    /// \brief Переводит вещественные параметры GLDM в целочисленные.
+    /// \param[in] delta Радиус поиска соседей.
+    /// \param[in] alpha Порог разности уровней серого.
+    /// \param[in] extent Наибольшая сторона изображения: соседей дальше `extent - 1` нет, и радиус обрезается до него.
+    Neighbourhood makeNeighbourhood(float delta, float alpha, int extent);
+
+    /// \brief Проверяет, может ли векторное ядро обработать окно данного радиуса.
+    ///
+    /// Счётчики в векторном ядре 8-битные, поэтому число соседей `(2r+1)^2 - 1` должно помещаться в байт.
+    bool isSimdAvailable(int radius);
+
+    /// \brief Считает число зависимых соседей для каждого пикселя строки (скалярная версия).
+    /// \tparam Level Тип уровня серого: `uchar` (до 256 уровней) или `ushort` (до 65536 уровней).
+    /// \param[in] rows Указатели на строки `y - r ... y + r`; `nullptr` для строк за границей изображения.
+    /// \param[in] cols Ширина строки.
+    /// \param[in] hood Параметры окрестности.
+    /// \param[out] counts Число зависимых соседей для каждого пикселя строки `rows[r]`.
+    template <typename Level>
+    void countRowScalar(const Level* const* rows, int cols, const Neighbourhood& hood, int* counts);
+
+    /// \brief Векторная версия `countRowScalar` на универсальных интринсиках OpenCV.
+    ///
+    /// Внутренняя часть строки обрабатывается блоками по 16 (`uchar`) или 8 (`ushort`) пикселей,
+    /// счётчики накапливаются в регистрах. Граничные столбцы считаются скалярно вне горячего цикла.
+    /// Результат побитово совпадает со скалярной версией.
+    template <typename Level>
+    void countRowSimd(const Level* const* rows, int cols, const Neighbourhood& hood, int* counts);
+
+    /// \brief Сигнатура построчного ядра подсчёта соседей.
+    template <typename Level>
+    using RowKernel = void (*)(const Level* const* rows, int cols, const Neighbourhood& hood, int* counts);
+
+    /// \brief Возвращает ядро, специализированное на этапе компиляции под радиус окна.
+    ///
+    /// Для радиусов 1, 2 и 3 таблица смещений известна при компиляции и полностью разворачивается,
+    /// внутренний цикл не содержит ветвлений. Для остальных радиусов возвращается `nullptr`.
+    template <typename Level>
+    RowKernel<Level> specializedRowKernel(int radius);
+
+    /// \brief Считает зависимых соседей сразу для нескольких порогов и радиусов.
+    ///
+    /// Разность с каждым соседом окна наибольшего радиуса вычисляется один раз и засчитывается
+    /// всем порогам, которые она проходит, и всем радиусам, в окно которых попадает сосед.
+    /// \param[in] rows Указатели на строки `y - R ... y + R`, где `R` - наибольший из `radii`.
+    /// \param[in] cols Ширина строки.
+    /// \param[in] thresholds Пороги разности уровней серого.
+    /// \param[in] radii Радиусы окна.
+    /// \param[out] counts Счётчики размера `thresholds.size() * radii.size() * cols`;
+    /// строка счётчиков для пары (a, d) начинается с `(a * radii.size() + d) * cols`.
+    template <typename Level>
+    void countRowSweep(const Level* const* rows, int cols, const std::vector<int>& thresholds,
+        const std::vector<int>& radii, int* counts);
+
+    /// \brief Засчитывает соседа пикселям, разность уровней с которым не больше порога.
+    ///
+    /// Используется при подборе параметров (`GLDMTuner`): модули разностей с соседом на одном
+    /// смещении посчитаны заранее, и смена порога сводится к одному сравнению на пиксель.
+    /// \param[in] diffs Модули разностей уровней серого пикселей строки с соседом.
+    /// \param[in] cols Число пикселей.
+    /// \param[in] threshold Порог разности уровней серого, не меньше 0.
+    /// \param[in,out] counts Счётчики зависимых соседей, к которым прибавляется 1.
+    template <typename Level>
+    void countWithinThreshold(const Level* diffs, int cols, int threshold, ushort* counts);
+}
+
+#endif
@@ -0,0 +1,353 @@
+#include "gldm.hpp"
+#include "generator.hpp"
+#include "gldmtuner.hpp"
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+
+/// \brief Эталонная матрица GLDM: попиксельный цикл исходной `GLDM::computeGLDM`.
+///
+/// Реализация намеренно заморожена: она не использует ни таблиц квантования, ни построчных ядер,
+/// ни целочисленных порогов, а сравнивает разность уровней с вещественным alpha, как исходный цикл.
+/// Все оптимизированные пути обязаны совпадать с ней побитово. Не менять при оптимизациях.
+/// \param[in] image Изображение `CV_8UC1` или `CV_16UC1`.
+/// \param[in] delta Радиус поиска соседей.
+/// \param[in] alpha Порог разности уровней серого.
+/// \param[in] quantization Параметры квантования.
+misis::GLDMMatrix referenceMatrix(const cv::Mat& image, misis::Real delta, misis::Real alpha,
+    const misis::GLDMQuantization& quantization)
+{
+    const int Ng = quantization.grayLevels;
+    const int64_t inputLevels = image.depth() == CV_16U ? 65536 : 256;
+    const auto level = [&](int y, int x) {
+        const int64_t value = image.depth() == CV_16U ? image.at<ushort>(y, x) : image.at<uchar>(y, x);
+        const int64_t quantized = quantization.mode == misis::QuantizationMode::Linear
+            ? value * Ng / inputLevels
+            : value / quantization.binWidth;
+        return static_cast<int>(std::min<int64_t>(quantized, Ng - 1));
+    };
+
+    // `for (int dy = -delta; dy <= delta; ++dy)` visits exactly [-floor(delta), floor(delta)];
+    // offsets beyond the image never hit a pixel, so the radius is capped at the largest side minus one.
+    // The matrix is as wide as the most neighbours the window can hold inside the image.
+    const int radius = delta >= 1 ? static_cast<int>(std::min<double>(std::floor(delta), std::max(image.rows, image.cols) - 1)) : 0;
+    const int maxDependence = std::min(2 * radius + 1, image.rows) * std::min(2 * radius + 1, image.cols) - 1;
+    misis::GLDMMatrix P(Ng, maxDependence);
+
+    for (int y = 0; y < image.rows; ++y) {
+        for (int x = 0; x < image.cols; ++x) {
+            int centerVal = level(y, x);
+            int count = 0;
+
+            for (int dy = -radius; dy <= radius; ++dy) {
+                for (int dx = -radius; dx <= radius; ++dx) {
+                    if (dx == 0 && dy == 0) continue;
+
+                    int nx = x + dx;
+                    int ny = y + dy;
+
+                    if (nx >= 0 && ny >= 0 && nx < image.cols && ny < image.rows) {
+                        int neighborVal = level(ny, nx);
+                        if (std::abs(centerVal - neighborVal) <= alpha) {
+                            count++;
+                        }
+                    }
+                }
+            }
+
+            if (count <= maxDependence)
+                P.data()[static_cast<size_t>(centerVal) * (maxDependence + 1) + count]++;
+        }
+    }
+    P.updateMarginals();
+    return P;
+}
+
+/// \brief Эталонные признаки GLDM по определениям, в два прохода по матрице.
+/// \param[in] P Матрица; индексы уровней и зависимостей в формулах считаются с 1.
+misis::GLDMFeatureSet referenceFeatures(const misis::GLDMMatrix& P)
+{
+    misis::GLDMFeatureSet f;
+    double Nz = 0, grayMean = 0, dependenceMean = 0;
+    for (int i = 0; i < P.grayLevels(); ++i)
+        for (int j = 0; j < P.dependenceSizes(); ++j) {
+            Nz += P.at(i, j);
+            grayMean += P.at(i, j) * (i + 1.0);
+            dependenceMean += P.at(i, j) * (j + 1.0);
+        }
+    if (Nz == 0)
+        return f;
+    grayMean /= Nz;
+    dependenceMean /= Nz;
+
+    std::vector<double> rowSums(P.grayLevels(), 0.0);
+    std::vector<double> colSums(P.dependenceSizes(), 0.0);
+    for (int i = 0; i < P.grayLevels(); ++i) {
+        for (int j = 0; j < P.dependenceSizes(); ++j) {
+            const double p = P.at(i, j);
+            if (p == 0) continue;
+            const double gi = i + 1.0;
+            const double dj = j + 1.0;
+            rowSums[i] += p;
+            colSums[j] += p;
+            f.SDE += p / (dj * dj);
+            f.LDE += p * dj * dj;
+            f.LGLE += p / (gi * gi);
+            f.HGLE += p * gi * gi;
+            f.SDLGLE += p / (gi * gi * dj * dj);
+            f.SDHGLE += p * gi * gi / (dj * dj);
+            f.LDLGLE += p * dj * dj / (gi * gi);
+            f.LDHGLE += p * gi * gi * dj * dj;
+            f.GLV += p / Nz * (gi - grayMean) * (gi - grayMean);
+            f.DV += p / Nz * (dj - dependenceMean) * (dj - dependenceMean);
+            f.DE -= p / Nz * std::log2(p / Nz);
+        }
+    }
+    for (const double sum : rowSums)
+        f.GLN += sum * sum;
+    for (const double sum : colSums)
+        f.DN += sum * sum;
+
+    f.SDE /= Nz; f.LDE /= Nz; f.LGLE /= Nz; f.HGLE /= Nz;
+    f.SDLGLE /= Nz; f.SDHGLE /= Nz; f.LDLGLE /= Nz; f.LDHGLE /= Nz;
+    f.GLN /= Nz;
+    f.DNN = f.DN / (Nz * Nz);
+    f.DN /= Nz;
+    return f;
+}
+
+/// \brief Сравнивает матрицы побитово.
+/// \param[out] difference Описание первого расхождения.
+bool sameMatrix(const misis::GLDMMatrix& expected, const misis::GLDMMatrix& actual, std::string& difference)
+{
+    if (expected.grayLevels() != actual.grayLevels() || expected.dependenceSizes() != actual.dependenceSizes()) {
+        difference = "size " + std::to_string(actual.grayLevels()) + "x" + std::to_string(actual.dependenceSizes())
+            + ", expected " + std::to_string(expected.grayLevels()) + "x" + std::to_string(expected.dependenceSizes());
+        return false;
+    }
+    for (int i = 0; i < expected.grayLevels(); ++i)
+        for (int j = 0; j < expected.dependenceSizes(); ++j)
+            if (expected.at(i, j) != actual.at(i, j)) {
+                difference = "P(" + std::to_string(i) + ", " + std::to_string(j) + ") = " + std::to_string(actual.at(i, j))
+                    + ", expected " + std::to_string(expected.at(i, j));
+                return false;
+            }
+    return true;
+}
+
+/// \brief Сравнивает каждый признак с относительной точностью 1e-9 от его собственного значения.
+/// \param[out] difference Описание первого расхождения.
+bool sameFeatures(const misis::GLDMFeatureSet& expected, const misis::GLDMFeatureSet& actual, std::string& difference)
+{
+    const auto e = expected.values();
+    const auto a = actual.values();
+    for (size_t k = 0; k < misis::GLDMFeatureSet::size; ++k) {
+        double scale = std::max(std::abs(e[k]), std::abs(a[k]));
+        // A variance is E[x^2] - E[x]^2, so its rounding error follows the moment it is subtracted from.
+        if (misis::GLDMFeatureSet::names[k] == "GLV")
+            scale = std::max(scale, expected.HGLE);
+        else if (misis::GLDMFeatureSet::names[k] == "DV")
+            scale = std::max(scale, expected.LDE);
+        if (std::abs(e[k] - a[k]) > 1e-9 * scale) {
+            difference = std::string(misis::GLDMFeatureSet::names[k]) + " = " + std::to_string(a[k]) + ", expected " + std::to_string(e[k]);
+            return false;
+        }
+    }
+    return true;
+}
+
+/// \brief Сохраняет изображение как бинарный PGM для построчного чтения.
+bool writePgm(const cv::Mat& image, const std::filesystem::path& path)
+{
+    std::ofstream file(path, std::ios::binary);
+    CheckReturn(file.is_open(), false);
+    const bool wide = image.depth() == CV_16U;
+    file << "P5\n" << image.cols << " " << image.rows << "\n" << (wide ? 65535 : 255) << "\n";
+    for (int y = 0; y < image.rows; ++y)
+        for (int x = 0; x < image.cols; ++x) {
+            if (wide) {
+                // PGM stores 16-bit samples most significant byte first.
+                const ushort value = image.at<ushort>(y, x);
+                file.put(static_cast<char>(value >> 8)).put(static_cast<char>(value & 0xFF));
+            }
+            else
+                file.put(static_cast<char>(image.at<uchar>(y, x)));
+        }
+    return static_cast<bool>(file);
+}
+
+/// \brief Входные данные одного сравнения.
+struct TestImage
+{
+    std::string name; ///< Имя для отчёта.
+    cv::Mat image; ///< Изображение, возможно - подматрица с шагом строк больше ширины.
+    misis::GLDMQuantization quantization; ///< Квантование.
+};
+
+/// \brief Вариант оптимизированного вычисления.
+struct Variant
+{
+    std::string name; ///< Имя для отчёта.
+    misis::GLDMKernel kernel; ///< Ядро.
+    int threads; ///< Число потоков.
+};
+
+/// \brief Время одного вызова в миллисекундах, лучшее из `repeats`.
+double bestMs(int repeats, const std::function<void()>& operation)
+{
+    double best = std::numeric_limits<double>::max();
+    for (int r = 0; r < repeats; ++r) {
+        const auto start = std::chrono::steady_clock::now();
+        operation();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+int main(int argc, char* argv[])
+{
+    int speedSize = 512;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--speed-size" && i + 1 < argc)
+            speedSize = std::stoi(argv[++i]);
+        else {
+            std::cout << "Usage: gldm_kernel_test [--speed-size <int>]   (0 skips the speed report)\n";
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    cv::RNG rng(22);
+    std::vector<TestImage> images;
+    const auto random8 = [&](int rows, int cols, int levels) {
+        cv::Mat image(rows, cols, CV_8UC1);
+        rng.fill(image, cv::RNG::UNIFORM, cv::Scalar(0), cv::Scalar(levels));
+        return image;
+    };
+    // Widths around the 16- and 8-pixel vector blocks exercise the scalar tails and borders.
+    for (const auto& [rows, cols] : std::vector<std::pair<int, int>>{ { 1, 1 }, { 1, 17 }, { 17, 1 }, { 3, 5 },
+             { 15, 16 }, { 16, 15 }, { 31, 33 }, { 64, 64 }, { 37, 100 } }) {
+        const std::string size = std::to_string(cols) + "x" + std::to_string(rows);
+        images.push_back({ "random/" + size, random8(rows, cols, 256), {} });
+        images.push_back({ "random8levels/" + size, random8(rows, cols, 8), {} });
+    }
+    images.push_back({ "random/64levels", random8(29, 41, 256), { 64 } });
+    images.push_back({ "random/fixed4", random8(29, 41, 256), { 64, misis::QuantizationMode::FixedBin, 4 } });
+    const cv::Mat large = random8(40, 50, 16);
+    images.push_back({ "roi/40x30", large(cv::Rect(3, 2, 40, 30)), {} });
+
+    cv::Mat wide(23, 40, CV_16UC1);
+    for (int y = 0; y < wide.rows; ++y)
+        for (int x = 0; x < wide.cols; ++x)
+            wide.at<ushort>(y, x) = static_cast<ushort>(rng.uniform(0, 4096) * 16);
+    images.push_back({ "random16/256levels", wide, {} });
+    images.push_back({ "random16/4096levels", wide, { 4096, misis::QuantizationMode::FixedBin, 16 } });
+    images.push_back({ "random16/1024levels", wide, { 1024 } });
+
+    GLDMFeatureImageGenerator generator(61, 47, 22);
+    for (int pattern = 0; pattern < GLDMFeatureImageGenerator::patternCount; ++pattern)
+        images.push_back({ std::string("generator/") + GLDMFeatureImageGenerator::patternNames[pattern], generator.generate(pattern), {} });
+
+    const std::vector<misis::Real> deltas = { 0, 0.5f, 1, 1.5f, 2, 3, 4, 7, 8 };
+    const std::vector<misis::Real> alphas = { -1, 0, 0.5f, 1, 3, 5.9f, 255, 70000 };
+    const std::vector<Variant> variants = {
+        { "scalar", misis::GLDMKernel::Scalar, 1 },
+        { "simd", misis::GLDMKernel::Simd, 1 },
+        { "specialized", misis::GLDMKernel::Specialized, 1 },
+        { "auto", misis::GLDMKernel::Auto, 1 },
+        { "scalar/threads3", misis::GLDMKernel::Scalar, 3 },
+        { "auto/threads4", misis::GLDMKernel::Auto, 4 },
+    };
+    const std::filesystem::path pgmPath = std::filesystem::temp_directory_path() / "gldm_kernel_test.pgm";
+
+    int checks = 0;
+    int failures = 0;
+    const auto check = [&](bool ok, const std::string& what, const std::string& difference) {
+        ++checks;
+        if (ok)
+            return;
+        ++failures;
+        std::cerr << "MISMATCH " << what << ": " << difference << std::endl;
+    };
+
+    for (const TestImage& test : images) {
+        // Radii far beyond the image are only affordable on tiny images.
+        std::vector<misis::Real> imageDeltas = deltas;
+        if (std::max(test.image.rows, test.image.cols) <= 17)
+            imageDeltas.push_back(1000);
+
+        misis::GLDM gldm;
+        gldm.importImageFromMat(test.image);
+        gldm.setQuantization(test.quantization);
+        const bool streamable = writePgm(test.image, pgmPath);
+        misis::GLDMTuner tuner;
+        check(tuner.setImage(test.image, test.quantization), test.name + " tuner", "the image was rejected");
+
+        // The sweep produces the whole grid from one traversal, in alpha-major order.
+        const std::vector<misis::GLDMMatrix> sweep = gldm.computeSweep(imageDeltas, alphas, 2);
+        check(sweep.size() == alphas.size() * imageDeltas.size(), test.name + " sweep", "wrong number of matrices");
+
+        for (size_t a = 0; a < alphas.size(); ++a) {
+            for (size_t d = 0; d < imageDeltas.size(); ++d) {
+                const misis::Real alpha = alphas[a];
+                const misis::Real delta = imageDeltas[d];
+                const std::string what = test.name + " delta=" + std::to_string(delta) + " alpha=" + std::to_string(alpha);
+                const misis::GLDMMatrix reference = referenceMatrix(test.image, delta, alpha, test.quantization);
+                const misis::GLDMFeatureSet features = referenceFeatures(reference);
+                std::string difference;
+
+                for (const Variant& variant : variants) {
+                    const misis::GLDMMatrix actual = misis::GLDM::computeMatrix(test.image, delta, alpha,
+                        test.quantization, variant.kernel, variant.threads);
+                    check(sameMatrix(reference, actual, difference), what + " " + variant.name, difference);
+                    check(sameFeatures(features, actual.computeAllFeatures(), difference), what + " " + variant.name + " features", difference);
+                }
+                if (a * imageDeltas.size() + d < sweep.size())
+                    check(sameMatrix(reference, sweep[a * imageDeltas.size() + d], difference), what + " sweep", difference);
+
+                if (delta <= tuner.maxRadius())
+                    check(sameMatrix(reference, tuner.computeMatrix(delta, alpha, 2), difference), what + " tuner", difference);
+
+                if (streamable && gldm.computeGLDMStreaming(pgmPath, delta, alpha)) {
+                    check(sameMatrix(reference, gldm.getMatrix(), difference), what + " streaming", difference);
+                    gldm.importImageFromMat(test.image);
+                }
+                else
+                    check(false, what + " streaming", "the PGM could not be read back");
+            }
+        }
+    }
+    std::filesystem::remove(pgmPath);
+    std::cout << checks - failures << " of " << checks << " comparisons match the reference" << std::endl;
+
+    if (speedSize > 0) {
+        GLDMFeatureImageGenerator speedGenerator(speedSize, speedSize, 22);
+        const cv::Mat image = speedGenerator.generateRandomNoiseImage();
+        const misis::GLDMQuantization quantization;
+        misis::GLDMTuner tuner;
+        tuner.setImage(image, quantization);
+        std::cout << "\nSpeed over the reference, " << speedSize << "x" << speedSize << " noise, alpha = 5:\n";
+        for (const misis::Real delta : { 1.0f, 2.0f, 3.0f, 5.0f }) {
+            const double referenceMs = bestMs(1, [&] { (void)referenceMatrix(image, delta, 5, quantization); });
+            std::cout << "delta = " << delta << ": reference " << std::fixed << std::setprecision(2) << referenceMs << " ms\n";
+            for (const Variant& variant : variants) {
+                const double ms = bestMs(3, [&] {
+                    (void)misis::GLDM::computeMatrix(image, delta, 5, quantization, variant.kernel, variant.threads);
+                });
+                std::cout << "  " << std::left << std::setw(16) << variant.name << std::right << std::setw(10) << ms
+                    << " ms  x" << std::setprecision(1) << referenceMs / ms << std::setprecision(2) << "\n";
+            }
+            // The tuner is timed after its difference planes exist, i.e. the cost of moving the alpha slider.
+            if (delta <= tuner.maxRadius()) {
+                (void)tuner.computeMatrix(delta, 5, 1);
+                const double ms = bestMs(3, [&] { (void)tuner.computeMatrix(delta, 5, 1); });
+                std::cout << "  " << std::left << std::setw(16) << "tuner" << std::right << std::setw(10) << ms
+                    << " ms  x" << std::setprecision(1) << referenceMs / ms << std::setprecision(2) << "\n";
+            }
+            std::cout << std::defaultfloat;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -1,7 +1,20 @@
 #include "gldm.hpp"
 #include "generator.hpp"
 #include "extractor.hpp"
+#include "batch.hpp"
+#include "pathsource.hpp"
+#include "resultwriter.hpp"
+#include "calibration.hpp"
+#include "server.hpp"
+#include "profiler.hpp"
+#include "resultbrowser.hpp"
+#include "similarityindex.hpp"
+#include <atomic>
+#include <cstdio>
 #include <filesystem>
+#include <limits>
+#include <optional>
+#include <set>
 
 /// \brief Функция создает генератор, а далее генерирует 6 тестовых изображений:
 /// - low_gray - изображение с низким уровнем серого
@@ -11,105 +24,93 @@
 /// - gradient - градиентное изображение
 /// - spot - изображение с круглым пятном в центре
 /// \param[in] path путь до папки, в которую будут сгенерированы данные изображения.
-void generateTestImages(const std::filesystem::path& path) {
+/// \param[in] width Ширина изображений.
+/// \param[in] height Высота изображений.
+/// \param[in] seed Зерно генератора.
+void generateTestImages(const std::filesystem::path& path, int width, int height, uint64_t seed) {
     if (path.has_filename())
     {
         return;
     }
-    GLDMFeatureImageGenerator generator;
+    GLDMFeatureImageGenerator generator(width, height, seed);
     std::cout << path.string() << std::endl;
-    generator.saveImage(generator.generateLowGrayLevelImage(), path.string() + ("low_gray.png"));
-    generator.saveImage(generator.generateHighDependenceUniformityImage(), path.string() +  "uniform_dep.png");
-    generator.saveImage(generator.generateHighDependenceNonUniformityImage(), path.string() + "nonuniform_dep.png");
-    generator.saveImage(generator.generateRandomNoiseImage(), path.string() + "noise.png");
-    generator.saveImage(generator.generateGradientImage(), path.string() + "gradient.png");
-    generator.saveImage(generator.generateSpotImage(), path.string() + "spot.png");
+    for (int pattern = 0; pattern < GLDMFeatureImageGenerator::patternCount; ++pattern)
+        generator.saveImage(generator.generate(pattern), path.string() + GLDMFeatureImageGenerator::patternNames[pattern] + ".png");
 }
 
-#include <opencv2/highgui.hpp>
-
-/// \brief Функция рисует текстовую подпись на изображении с полупрозрачным фоном.
-/// \param[in,out] image Изображение OpenCV (`cv::Mat`), на котором будет нарисован текст.
-/// \param[in] text Строка текста, которая будет отображена.
-/// \param[in] origin Координаты нижнего левого угла текста на изображении.
-/// \param[in] fontFace Шрифт текста.
-/// \param[in] fontScale Масштаб шрифта.
-/// \param[in] thickness Толщина линий текста.
-/// \param[in] textColor Цвет текста в формате.
-/// \param[in] bgColor Цвет фона под текстом.
-/// \param[in] alpha Прозрачность фона.
-static void drawLabelWithBackground(cv::Mat& image,
-    const std::string& text,
-    cv::Point origin,
-    int fontFace = cv::FONT_HERSHEY_SIMPLEX,
-    double fontScale = 0.6,
-    int thickness = 1,
-    cv::Scalar textColor = cv::Scalar(255, 255, 255),
-    cv::Scalar bgColor = cv::Scalar(0, 0, 0),
-    double alpha = 0.5)
+/// \brief Генерирует набор из `count` изображений, виды которых идут по очереди.
+///
+/// Изображение с номером i генерируется с зерном `imageSeed(seed, i)`, поэтому набор
+/// не зависит от числа потоков и порядка их работы. Файлы раскладываются по папкам
+/// `00000`, `00001`, ... по 10000 штук и называются `<вид>_<номер>.png`.
+/// \param[in] path Папка набора.
+/// \param[in] count Число изображений.
+/// \param[in] width Ширина изображений.
+/// \param[in] height Высота изображений.
+/// \param[in] seed Зерно набора.
+/// \return `false`, если часть изображений не удалось сохранить.
+bool generateDataset(const std::filesystem::path& path, uint64_t count, int width, int height, uint64_t seed)
 {
-    int baseline = 0;
-    cv::Size textSize = cv::getTextSize(text, fontFace, fontScale, thickness, &baseline);
-    cv::Rect bgRect(origin.x - 5,
-        origin.y - textSize.height - 5,
-        textSize.width + 10,
-        textSize.height + 10);
-
-    bgRect &= cv::Rect(0, 0, image.cols, image.rows);
-
-    cv::Mat roi = image(bgRect);
-    cv::Mat overlay = roi.clone();
-    cv::rectangle(overlay, cv::Rect(0, 0, bgRect.width, bgRect.height), bgColor, cv::FILLED);
-
-    cv::addWeighted(overlay, alpha, roi, 1.0 - alpha, 0.0, roi);
-    
-    cv::putText(image,
-        text,
-        cv::Point(origin.x, origin.y - 2),
-        fontFace,
-        fontScale,
-        textColor,
-        thickness,
-        cv::LINE_AA);
-}
-
+    CheckReturn(count <= static_cast<uint64_t>(std::numeric_limits<int>::max()), false);
+    const uint64_t perDirectory = 10000;
+    char name[64];
+    for (uint64_t directory = 0; directory * perDirectory < count; ++directory) {
+        std::snprintf(name, sizeof(name), "%05llu", static_cast<unsigned long long>(directory));
+        std::filesystem::create_directories(path / name);
+    }
 
-/// \brief Функция отображает результаты анализа GLDM в графическом интерфейсе.
-/// \param[in] results Результаты анализов.
-/// \note Функция блокирует выполнение на каждом изображении до нажатия клавиши.
-void showGuiResults(const std::vector<misis::AnalysisResult>& results)
-{
-    for (const auto& res : results)
-    {
-        cv::Mat img = cv::imread(res.imageName, cv::IMREAD_GRAYSCALE);
-        if (img.empty())
-        {
-            std::cerr << "[!] Failed to load " << res.imageName << '\n';
-            continue;
+    std::atomic<uint64_t> failed = 0;
+    cv::parallel_for_(cv::Range(0, static_cast<int>(count)), [&](const cv::Range& range) {
+        char fileName[64];
+        for (int index = range.start; index < range.end; ++index) {
+            GLDMFeatureImageGenerator generator(width, height, GLDMFeatureImageGenerator::imageSeed(seed, index));
+            const int pattern = index % GLDMFeatureImageGenerator::patternCount;
+            std::snprintf(fileName, sizeof(fileName), "%05llu/%s_%08d.png",
+                static_cast<unsigned long long>(index / perDirectory), GLDMFeatureImageGenerator::patternNames[pattern], index);
+            if (!cv::imwrite((path / fileName).string(), generator.generate(pattern)))
+                failed++;
         }
+    });
 
-        cv::Mat display;
-        cv::cvtColor(img, display, cv::COLOR_GRAY2BGR);
-
-        int y = 30;
-        drawLabelWithBackground(display, "Image: " + res.imageName,
-            { 10, y });                          y += 30;
-
-        drawLabelWithBackground(display, "LGLE: " + std::to_string(res.LGLE),
-            { 10, y });                          y += 30;
-
-        drawLabelWithBackground(display, "DN: " + std::to_string(res.DN),
-            { 10, y });                          y += 30;
-
-        drawLabelWithBackground(display, "Category:", { 10, y });    y += 25;
+    std::cout << count - failed << " images generated in " << path.string() << std::endl;
+    CheckReturn(failed == 0, false);
+    return true;
+}
 
-        drawLabelWithBackground(display, res.category, { 10, y });   y += 30;
+/// \brief Разбирает размер вида `WxH`, например `512x256`.
+/// \param[in] text Строка аргумента командной строки.
+/// \param[out] width Ширина.
+/// \param[out] height Высота.
+/// \return `false`, если строка не описывает положительный размер.
+bool parseSize(const std::string& text, int& width, int& height)
+{
+    const size_t separator = text.find_first_of("xX");
+    CheckReturn(separator != std::string::npos, false);
+    try
+    {
+        width = std::stoi(text.substr(0, separator));
+        height = std::stoi(text.substr(separator + 1));
+    }
+    catch (...)
+    {
+        return false;
+    }
+    return width > 0 && height > 0;
+}
 
-        cv::imshow("GLDM Result", display);
-        std::cout << "[i] Showing image: " << res.imageName << '\n';
-        cv::waitKey(0); 
+/// \brief Разбирает список значений через запятую, например `2,5,10`.
+/// \param[in] text Строка аргумента командной строки.
+/// \return Значения в порядке следования.
+std::vector<misis::Real> parseValueList(const std::string& text)
+{
+    std::vector<misis::Real> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty())
+            values.push_back(static_cast<misis::Real>(std::stoi(item)));
     }
-    cv::destroyAllWindows();
+    return values;
 }
 
 
@@ -117,20 +118,84 @@ int main(int argc, char* argv[]) {
     if (argc < 2) {
         std::cout << "Usage:\n"
             << "  --generate <dir>             Generate test images in the <dir> directory\n"
+            << "  [--count <int>]              With --generate: generate a dataset of N images in parallel\n"
+            << "  [--size <W>x<H>]             With --generate: image size (default: 1024x512)\n"
+            << "  [--seed <int>]               With --generate: random seed, same seed gives same images (default: 2025)\n"
             << "  --analyze <img1> <img2> ...  Analyze provided image(s)\n"
+            << "  --list <file.lst>            Analyze images listed in a file, one path per line\n"
+            << "  --analyze-dir <dir>          Analyze images in a directory\n"
+            << "  [--recursive]                Also descend into subdirectories of --analyze-dir\n"
+            << "  [--ext <ext>[,<ext>...]]     Extensions taken from --analyze-dir (default: png,jpg,jpeg,tif,tiff,bmp,pgm,pnm)\n"
             << "  --output_directory           Output directory for analyzytor\n"
-            << "  -gui                         Use GUI\n"
-            << "  [--alpha <int>]              Threshold (default: 5)\n"
-            << "  [--delta <int>]              Neighborhood radius (default: 1)\n";
+            << "  --gui                        Browse results: thumbnail grid and single view with prefetch\n"
+            << "  [--alpha <int>[,<int>...]]   Threshold (default: 5)\n"
+            << "  [--delta <int>[,<int>...]]   Neighborhood radius, 0..127 (default: 1)\n"
+            << "                               Several values run a sweep over every (alpha, delta) pair\n"
+            << "  [--feature-maps <int>]       Also save local LGLE/DN maps for a W x W window\n"
+            << "  [--levels <int>]             Number of gray levels Ng, 2..65536 (default: 256)\n"
+            << "  [--quantization linear|fixed] Linear over the pixel range or fixed-width bins (default: linear)\n"
+            << "  [--bin-width <int>]          Bin width for fixed quantization (default: 1)\n"
+            << "  [--streaming]                Read PGM images in strips with bounded memory\n"
+            << "  [--threads <int>]            Threads per image, 0 = all cores (default: 1)\n"
+            << "  [--jobs <int>]               Images analyzed in parallel (default: 1)\n"
+            << "  [--no-cache]                 Do not read or write the matrix cache\n"
+            << "  [--rebuild-cache]            Recompute every matrix and overwrite its cache entry\n"
+            << "  [--cache-dir <dir>]          Matrix cache directory (default: <output_directory>/gldm_cache)\n"
+            << "  [--cache-size <int>]         Cache size limit in MiB, 0 = unlimited (default: 1024)\n"
+            << "  [--decode-jobs <int>]        Images decoded in parallel (default: same as --jobs)\n"
+            << "  [--format csv|jsonl|bin|txt] Results file format (default: csv)\n"
+            << "  [--shard-size <int>]         Records per results file, 0 = one file (default: 0)\n"
+            << "  [--fast-decode 2|4|8]        Decode images reduced N times in gray for approximate features\n"
+            << "  [--calibrate]                With --fast-decode: compare with full resolution and save calibration.csv\n"
+            << "  --serve                      Answer JSON-lines requests {\"path\"|\"bytes\", \"alpha\", \"delta\"} on stdin\n"
+            << "  [--socket <path>]            With --serve: listen on a Unix socket instead of stdin\n"
+            << "  [--build-index <file>]       Also save a texture similarity index of the analyzed images\n"
+            << "  [--index-lists <int>]        With --build-index: coarse quantizer lists, 1 = brute force only (default: sqrt(N) from 10000 images)\n"
+            << "  --query <img> --index <file> Print the images of the index most similar to <img>\n"
+            << "  [--k <int>]                  With --query: number of results (default: 10)\n"
+            << "  [--nprobe <int>]             With --query: lists scanned per query (default: 8)\n"
+            << "  [--profile]                  Print per-stage latency percentiles and throughput at exit\n"
+            << "  [--profile-trace <file>]     With --profile: also save a Chrome trace_event JSON file\n";
         return 0;
     }
 
     std::vector<std::string> imagesToAnalyze;
+    std::vector<std::filesystem::path> listFiles;
+    std::vector<std::filesystem::path> directories;
+    bool recursive = false;
+    std::set<std::string> extensions = misis::parseExtensionList("png,jpg,jpeg,tif,tiff,bmp,pgm,pnm");
     std::filesystem::path generationDir;
     std::filesystem::path outputDir;
     bool doGenerate = false;
-    int alpha = 5;
-    int delta = 1;
+    uint64_t generateCount = 0;
+    int generateWidth = 1024;
+    int generateHeight = 512;
+    uint64_t generateSeed = 2025;
+    std::vector<misis::Real> alphas = { 5 };
+    std::vector<misis::Real> deltas = { 1 };
+    int threads = 1;
+    int featureMapWindow = 0;
+    bool streaming = false;
+    misis::GLDMQuantization quantization;
+    misis::BatchOptions batchOptions;
+    misis::CacheMode cacheMode = misis::CacheMode::ReadWrite;
+    std::filesystem::path cacheDir;
+    uint64_t cacheSizeMiB = 1024;
+    int decodeJobs = 0;
+    misis::ResultFormat resultFormat = misis::ResultFormat::Csv;
+    uint64_t shardSize = 0;
+    int decodeReduction = 1;
+    bool calibrate = false;
+    bool serve = false;
+    std::filesystem::path socketPath;
+    bool profile = false;
+    std::filesystem::path profileTrace;
+    std::filesystem::path buildIndexPath;
+    int indexLists = 0;
+    std::string queryImage;
+    std::filesystem::path indexPath;
+    size_t queryK = 10;
+    int queryProbes = 8;
 
     bool guiMode = false;
     std::vector<misis::AnalysisResult> guiResults;
@@ -150,6 +215,18 @@ int main(int argc, char* argv[]) {
             ++i;
             
         }
+        else if (arg == "--count" && i + 1 < argc) {
+            generateCount = std::stoull(argv[++i]);
+        }
+        else if (arg == "--size" && i + 1 < argc) {
+            if (!parseSize(argv[++i], generateWidth, generateHeight)) {
+                std::cerr << "--size must look like 512x256. Aborting";
+                return 1;
+            }
+        }
+        else if (arg == "--seed" && i + 1 < argc) {
+            generateSeed = std::stoull(argv[++i]);
+        }
         else if (arg == "--analyze") {
             ++i;
             while (i < argc && std::string(argv[i]).rfind("--", 0) != 0) {
@@ -158,6 +235,18 @@ int main(int argc, char* argv[]) {
             }
             --i;
         }
+        else if (arg == "--list" && i + 1 < argc) {
+            listFiles.push_back(argv[++i]);
+        }
+        else if (arg == "--analyze-dir" && i + 1 < argc) {
+            directories.push_back(argv[++i]);
+        }
+        else if (arg == "--recursive") {
+            recursive = true;
+        }
+        else if (arg == "--ext" && i + 1 < argc) {
+            extensions = misis::parseExtensionList(argv[++i]);
+        }
         else if (arg == "--gui") {
             guiMode = true;
         }
@@ -171,10 +260,108 @@ int main(int argc, char* argv[]) {
             ++i;
         }
         else if (arg == "--alpha" && i + 1 < argc) {
-            alpha = std::stoi(argv[++i]);
+            alphas = parseValueList(argv[++i]);
         }
         else if (arg == "--delta" && i + 1 < argc) {
-            delta = std::stoi(argv[++i]);
+            deltas = parseValueList(argv[++i]);
+        }
+        else if (arg == "--feature-maps" && i + 1 < argc) {
+            featureMapWindow = std::stoi(argv[++i]);
+            if (featureMapWindow <= 0 || featureMapWindow % 2 == 0)
+            {
+                std::cerr << "The feature map window must be a positive odd number. Aborting";
+                return 1;
+            }
+        }
+        else if (arg == "--levels" && i + 1 < argc) {
+            quantization.grayLevels = std::stoi(argv[++i]);
+        }
+        else if (arg == "--quantization" && i + 1 < argc) {
+            const std::string mode = argv[++i];
+            if (mode == "linear")
+                quantization.mode = misis::QuantizationMode::Linear;
+            else if (mode == "fixed")
+                quantization.mode = misis::QuantizationMode::FixedBin;
+            else
+            {
+                std::cerr << "Unknown quantization mode: " << mode << ". Aborting";
+                return 1;
+            }
+        }
+        else if (arg == "--bin-width" && i + 1 < argc) {
+            quantization.binWidth = std::stoi(argv[++i]);
+        }
+        else if (arg == "--streaming") {
+            streaming = true;
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::stoi(argv[++i]);
+        }
+        else if (arg == "--no-cache") {
+            cacheMode = misis::CacheMode::Off;
+        }
+        else if (arg == "--rebuild-cache") {
+            cacheMode = misis::CacheMode::Rebuild;
+        }
+        else if (arg == "--cache-dir" && i + 1 < argc) {
+            cacheDir = argv[++i];
+        }
+        else if (arg == "--cache-size" && i + 1 < argc) {
+            cacheSizeMiB = std::stoull(argv[++i]);
+        }
+        else if (arg == "--jobs" && i + 1 < argc) {
+            batchOptions.computeWorkers = std::stoi(argv[++i]);
+        }
+        else if (arg == "--decode-jobs" && i + 1 < argc) {
+            decodeJobs = std::stoi(argv[++i]);
+        }
+        else if (arg == "--format" && i + 1 < argc) {
+            const std::string format = argv[++i];
+            if (!misis::parseResultFormat(format, resultFormat))
+            {
+                std::cerr << "Unknown results format: " << format << ". Aborting";
+                return 1;
+            }
+        }
+        else if (arg == "--shard-size" && i + 1 < argc) {
+            shardSize = std::stoull(argv[++i]);
+        }
+        else if (arg == "--fast-decode" && i + 1 < argc) {
+            decodeReduction = std::stoi(argv[++i]);
+        }
+        else if (arg == "--calibrate") {
+            calibrate = true;
+        }
+        else if (arg == "--serve") {
+            serve = true;
+        }
+        else if (arg == "--socket" && i + 1 < argc) {
+            socketPath = argv[++i];
+        }
+        else if (arg == "--build-index" && i + 1 < argc) {
+            buildIndexPath = argv[++i];
+        }
+        else if (arg == "--index-lists" && i + 1 < argc) {
+            indexLists = std::stoi(argv[++i]);
+        }
+        else if (arg == "--query" && i + 1 < argc) {
+            queryImage = argv[++i];
+        }
+        else if (arg == "--index" && i + 1 < argc) {
+            indexPath = argv[++i];
+        }
+        else if (arg == "--k" && i + 1 < argc) {
+            queryK = std::stoull(argv[++i]);
+        }
+        else if (arg == "--nprobe" && i + 1 < argc) {
+            queryProbes = std::stoi(argv[++i]);
+        }
+        else if (arg == "--profile") {
+            profile = true;
+        }
+        else if (arg == "--profile-trace" && i + 1 < argc) {
+            profile = true;
+            profileTrace = argv[++i];
         }
         else {
             std::cout << "Unknown option: " << arg << std::endl;
@@ -182,21 +369,181 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    // The report is printed when main returns, whichever mode ran.
+    std::optional<misis::ProfileSession> profileSession;
+    if (profile)
+        profileSession.emplace(profileTrace);
+
     if (doGenerate) {
-        generateTestImages(generationDir);
+        if (generateCount == 0)
+            generateTestImages(generationDir, generateWidth, generateHeight, generateSeed);
+        else if (!generateDataset(generationDir, generateCount, generateWidth, generateHeight, generateSeed))
+            return 1;
+    }
+
+    if (alphas.empty() || deltas.empty()) {
+        std::cerr << "--alpha and --delta need at least one value. Aborting";
+        return 1;
+    }
+    const bool sweepMode = alphas.size() > 1 || deltas.size() > 1;
+
+    if (!misis::GLDMExtractor::get().setQuantization(quantization)) {
+        std::cerr << "--levels must be in 2..65536 and --bin-width must be positive. Aborting";
+        return 1;
+    }
+    // Matrices are sized by delta, so a huge radius is refused here rather than failing to allocate later.
+    for (const misis::Real delta : deltas) {
+        if (!misis::GLDM::isValidDelta(delta, quantization.grayLevels)) {
+            std::cerr << "--delta must be in 0.." << misis::GLDM::maxDeltaFor(quantization.grayLevels)
+                << " for " << quantization.grayLevels << " gray levels. Aborting";
+            return 1;
+        }
+    }
+
+    if (batchOptions.computeWorkers < 1 || decodeJobs < 0) {
+        std::cerr << "--jobs must be positive. Aborting";
+        return 1;
+    }
+    batchOptions.decodeWorkers = decodeJobs > 0 ? decodeJobs : batchOptions.computeWorkers;
+
+    // Paths are pulled lazily from every input in command-line order, so huge lists never sit in memory at once.
+    misis::ChainedPathSource inputs;
+    const bool hasInputs = !imagesToAnalyze.empty() || !listFiles.empty() || !directories.empty();
+    inputs.add(std::make_unique<misis::VectorPathSource>(std::move(imagesToAnalyze)));
+    for (const std::filesystem::path& list : listFiles) {
+        auto source = std::make_unique<misis::ListFilePathSource>(list);
+        if (!source->isOpen())
+            return 1;
+        inputs.add(std::move(source));
+    }
+    for (const std::filesystem::path& directory : directories) {
+        auto source = std::make_unique<misis::DirectoryPathSource>(directory, recursive, extensions);
+        if (!source->isOpen())
+            return 1;
+        inputs.add(std::move(source));
+    }
+
+    misis::GLDMExtractor& extractor = misis::GLDMExtractor::get();
+    if (!extractor.setDecodeReduction(decodeReduction)) {
+        std::cerr << "--fast-decode must be 2, 4 or 8. Aborting";
+        return 1;
+    }
+    if (calibrate && decodeReduction == 1) {
+        std::cerr << "--calibrate needs --fast-decode. Aborting";
+        return 1;
+    }
+    extractor.setParams(alphas.front(), deltas.front());
+    extractor.setThreads(threads);
+    extractor.setStreaming(streaming);
+    extractor.setFeatureMapWindow(featureMapWindow);
+    if (cacheMode != misis::CacheMode::Off && (hasInputs || serve || !queryImage.empty())) {
+        if (cacheDir.empty())
+            cacheDir = outputDir / "gldm_cache";
+        auto cache = std::make_shared<misis::GLDMCache>(cacheDir, cacheSizeMiB << 20);
+        if (cache->isOpen())
+            extractor.setCache(std::move(cache), cacheMode);
+    }
+
+    if (serve) {
+        // Requests choose their own alpha and delta; the command-line values are the defaults.
+        misis::GLDMServer server(extractor, batchOptions.computeWorkers, alphas.front(), deltas.front());
+        if (!socketPath.empty())
+            return server.serveSocket(socketPath) ? 0 : 1;
+        server.serveStream(std::cin, std::cout);
+        return 0;
+    }
+
+    if (!queryImage.empty()) {
+        misis::SimilarityIndex index;
+        if (indexPath.empty() || !index.open(indexPath)) {
+            std::cerr << "--query needs an index built with --build-index, passed as --index <file>. Aborting";
+            return 1;
+        }
+        // The query is described with exactly the parameters the corpus was analyzed with.
+        if (!extractor.setQuantization(index.getQuantization())
+            || !extractor.setParams(index.getAlpha(), index.getDelta())
+            || !extractor.setDecodeReduction(index.getDecodeReduction())) {
+            std::cerr << "The index was built with unsupported analysis parameters. Aborting";
+            return 1;
+        }
+        const misis::AnalysisResult query = extractor.analyze(queryImage);
+        if (query.category == "Invalid") {
+            std::cerr << "Failed to analyze the query image: " << queryImage << std::endl;
+            return 1;
+        }
+        std::cout << "rank\tdistance\timage\n";
+        size_t rank = 0;
+        for (const misis::SimilarityMatch& match : index.search(query.features, queryK, queryProbes))
+            std::cout << ++rank << '\t' << match.distance << '\t' << match.imageName << '\n';
+        std::cout << std::flush;
+        return 0;
+    }
+
+    if (!buildIndexPath.empty() && sweepMode) {
+        std::cerr << "--build-index needs a single --alpha and --delta. Aborting";
+        return 1;
+    }
+    // A sweep computes one matrix per pair but no per-pixel maps, so the option would be silently lost.
+    if (featureMapWindow > 0 && sweepMode) {
+        std::cerr << "--feature-maps needs a single --alpha and --delta. Aborting";
+        return 1;
+    }
+    if (indexLists < 0) {
+        std::cerr << "--index-lists must not be negative. Aborting";
+        return 1;
+    }
+    // Features are taken from the results the batch computes anyway, so indexing adds no image pass.
+    std::optional<misis::SimilarityIndexBuilder> indexBuilder;
+    if (!buildIndexPath.empty())
+        indexBuilder.emplace(alphas.front(), deltas.front(), quantization, decodeReduction);
+
+    if (calibrate) {
+        // Images are analyzed one at a time so that the timings are not skewed by each other.
+        misis::DecodeCalibration calibration(extractor, decodeReduction);
+        std::string path;
+        while (inputs.next(path))
+            calibration.add(path);
+        return calibration.saveReport(outputDir.string()) ? 0 : 1;
     }
 
-    if (!imagesToAnalyze.empty()) {
-        misis::GLDMExtractor& extractor = misis::GLDMExtractor::get();
-        for (const std::string& img : imagesToAnalyze) {
-            extractor.setParams(alpha, delta);
-            extractor.analyzeAndSaveSummary(img, outputDir.string());
-            guiResults.push_back(extractor.analyze(img));
+    misis::BatchAnalyzer batch(extractor, batchOptions);
+    if (sweepMode)
+        batch.setSweep(alphas, deltas);
+
+    std::unique_ptr<misis::ResultWriter> writer = misis::ResultWriter::create(resultFormat, extractor, outputDir, sweepMode, shardSize);
+    batch.run(inputs, [&](std::vector<misis::AnalysisResult>& results) {
+        for (misis::AnalysisResult& result : results) {
+            {
+                GLDM_PROFILE_SCOPE("ResultWriter::write");
+                writer->write(result);
+            }
+            if (featureMapWindow > 0)
+                extractor.saveFeatureMaps(result, outputDir.string());
+            if (indexBuilder)
+                indexBuilder->add(result);
+            if (guiMode) {
+                // The browser decodes images on demand, so a kept result holds only its path and values.
+                result.maps = misis::GLDMFeatureMaps();
+                guiResults.push_back(std::move(result));
+            }
+        }
+    });
+    if (!writer->close())
+        return 1;
+    if (indexBuilder) {
+        if (!indexBuilder->save(buildIndexPath, indexLists)) {
+            std::cerr << "Failed to write the similarity index: " << buildIndexPath.string() << std::endl;
+            return 1;
         }
+        std::cout << "Similarity index of " << indexBuilder->size() << " images written to: " << buildIndexPath.string() << std::endl;
     }
 
     if (guiMode && !guiResults.empty()) {
-        showGuiResults(guiResults);
+        // Images are decoded and live values recomputed with the same reduction and gray levels as the analysis.
+        misis::BrowserOptions browserOptions;
+        browserOptions.quantization = quantization;
+        browserOptions.decodeReduction = decodeReduction;
+        misis::browseResults(guiResults, browserOptions);
     }
 
 
@@ -0,0 +1,56 @@
+#pragma once
+
+#ifndef GLDMMappedFile_2025
+#define GLDMMappedFile_2025
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace misis
+{
+    /// \brief Файл, отображённый в память только для чтения.
+    ///
+    /// Содержимое подгружается операционной системой по мере обращения, без копирования в буфер процесса.
+    class MappedFile final
+    {
+    public:
+        /// \brief Создаёт пустой объект.
+        MappedFile() = default;
+
+        /// \brief Отображает файл в память.
+        /// \param[in] path Путь к файлу.
+        explicit MappedFile(const std::filesystem::path& path);
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        /// \brief Снимает отображение.
+        ~MappedFile();
+
+        /// \brief Проверяет, что файл отображён. Пустой файл считается отображённым.
+        [[nodiscard]] bool isOpen() const { return opened; }
+
+        /// \brief Начало содержимого файла.
+        [[nodiscard]] const uint8_t* data() const { return bytes; }
+
+        /// \brief Размер файла в байтах.
+        [[nodiscard]] size_t size() const { return length; }
+
+    private:
+        /// \brief Снимает отображение и закрывает файл.
+        void close();
+
+        const uint8_t* bytes = nullptr; ///< Отображённое содержимое.
+        size_t length = 0; ///< Размер файла.
+        bool opened = false; ///< Файл успешно отображён.
+#ifdef _WIN32
+        void* fileHandle = nullptr; ///< Дескриптор файла.
+        void* mappingHandle = nullptr; ///< Дескриптор отображения.
+#endif
+    };
+}
+
+#endif
@@ -0,0 +1,142 @@
+#include "pathsource.hpp"
+#include <cctype>
+#include <iostream>
+#include <sstream>
+
+using namespace misis;
+
+namespace
+{
+    std::string toLower(std::string text)
+    {
+        for (char& c : text)
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        return text;
+    }
+}
+
+VectorPathSource::VectorPathSource(std::vector<std::string> paths)
+    : paths(std::move(paths))
+{
+}
+
+bool VectorPathSource::next(std::string& path)
+{
+    if (position >= paths.size())
+        return false;
+    path = paths[position++];
+    return true;
+}
+
+ListFilePathSource::ListFilePathSource(const std::filesystem::path& listPath)
+    : file(listPath)
+    , baseDirectory(listPath.parent_path())
+{
+    if (!file.is_open())
+        std::cerr << "Could not open the list file: " << listPath.string() << std::endl;
+}
+
+bool ListFilePathSource::isOpen() const
+{
+    return file.is_open();
+}
+
+bool ListFilePathSource::next(std::string& path)
+{
+    std::string line;
+    while (std::getline(file, line)) {
+        // Lists written on Windows keep their '\r'; it is never part of a file name.
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty())
+            continue;
+
+        const std::filesystem::path entry(line);
+        path = entry.is_absolute() ? entry.string() : (baseDirectory / entry).string();
+        return true;
+    }
+    return false;
+}
+
+DirectoryPathSource::DirectoryPathSource(const std::filesystem::path& directory, bool recursive, std::set<std::string> extensions)
+    : recursive(recursive)
+    , extensions(std::move(extensions))
+{
+    std::error_code error;
+    if (recursive)
+        deep = std::filesystem::recursive_directory_iterator(directory, std::filesystem::directory_options::skip_permission_denied, error);
+    else
+        flat = std::filesystem::directory_iterator(directory, std::filesystem::directory_options::skip_permission_denied, error);
+
+    valid = !error;
+    if (!valid)
+        std::cerr << "Could not open the directory: " << directory.string() << " (" << error.message() << ")" << std::endl;
+}
+
+bool DirectoryPathSource::isOpen() const
+{
+    return valid;
+}
+
+bool DirectoryPathSource::accepts(const std::filesystem::path& path) const
+{
+    if (extensions.empty())
+        return true;
+    std::string extension = path.extension().string();
+    if (!extension.empty())
+        extension.erase(0, 1);
+    return extensions.count(toLower(extension)) > 0;
+}
+
+bool DirectoryPathSource::next(std::string& path)
+{
+    if (!valid)
+        return false;
+
+    // Entries are pulled one at a time straight from the OS, so huge directories are never listed up front.
+    std::error_code error;
+    const auto take = [&](auto& iterator) {
+        for (; iterator != std::decay_t<decltype(iterator)>(); iterator.increment(error)) {
+            if (error) {
+                std::cerr << "Directory traversal stopped: " << error.message() << std::endl;
+                return false;
+            }
+            const std::filesystem::directory_entry& entry = *iterator;
+            if (entry.is_regular_file(error) && accepts(entry.path())) {
+                path = entry.path().string();
+                iterator.increment(error);
+                return true;
+            }
+        }
+        return false;
+    };
+    return recursive ? take(deep) : take(flat);
+}
+
+void ChainedPathSource::add(std::unique_ptr<PathSource> source)
+{
+    sources.push_back(std::move(source));
+}
+
+bool ChainedPathSource::next(std::string& path)
+{
+    for (; current < sources.size(); ++current) {
+        if (sources[current]->next(path))
+            return true;
+    }
+    return false;
+}
+
+std::set<std::string> misis::parseExtensionList(const std::string& text)
+{
+    std::set<std::string> extensions;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty() && item.front() == '.')
+            item.erase(0, 1);
+        if (!item.empty())
+            extensions.insert(toLower(item));
+    }
+    return extensions;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#ifndef GLDMPathSource_2025
+#define GLDMPathSource_2025
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace misis
+{
+    /// \brief Источник путей к изображениям для пакетного анализа.
+    ///
+    /// Отдаёт пути по одному, поэтому список не обязан помещаться в память целиком.
+    class PathSource
+    {
+    public:
+        virtual ~PathSource() = default;
+
+        /// \brief Возвращает следующий путь.
+        /// \param[out] path Путь к изображению.
+        /// \return `false`, если пути закончились.
+        virtual bool next(std::string& path) = 0;
+    };
+
+    /// \brief Пути, заданные списком (например, из командной строки).
+    class VectorPathSource final : public PathSource
+    {
+    public:
+        /// \param[in] paths Пути к изображениям.
+        explicit VectorPathSource(std::vector<std::string> paths);
+
+        bool next(std::string& path) override;
+
+    private:
+        std::vector<std::string> paths; ///< Пути к изображениям.
+        size_t position = 0; ///< Индекс следующего пути.
+    };
+
+    /// \brief Пути из файла списка `.lst`, по одному на строку.
+    ///
+    /// Как и `get_list_of_file_paths` из semcv, относительные пути отсчитываются от папки,
+    /// в которой лежит файл списка. Пустые строки пропускаются.
+    class ListFilePathSource final : public PathSource
+    {
+    public:
+        /// \param[in] listPath Путь к файлу списка.
+        explicit ListFilePathSource(const std::filesystem::path& listPath);
+
+        /// \brief Проверяет, что файл списка открыт.
+        [[nodiscard]] bool isOpen() const;
+
+        bool next(std::string& path) override;
+
+    private:
+        std::ifstream file; ///< Открытый файл списка.
+        std::filesystem::path baseDirectory; ///< Папка файла списка.
+    };
+
+    /// \brief Файлы изображений в папке, по мере обхода каталога.
+    class DirectoryPathSource final : public PathSource
+    {
+    public:
+        /// \param[in] directory Папка с изображениями.
+        /// \param[in] recursive Обходить вложенные папки.
+        /// \param[in] extensions Допустимые расширения в нижнем регистре без точки; пусто - любые.
+        DirectoryPathSource(const std::filesystem::path& directory, bool recursive, std::set<std::string> extensions);
+
+        /// \brief Проверяет, что папку удалось открыть.
+        [[nodiscard]] bool isOpen() const;
+
+        bool next(std::string& path) override;
+
+    private:
+        /// \brief Проверяет, подходит ли файл по расширению.
+        [[nodiscard]] bool accepts(const std::filesystem::path& path) const;
+
+        std::filesystem::directory_iterator flat; ///< Обход без вложенных папок.
+        std::filesystem::recursive_directory_iterator deep; ///< Рекурсивный обход.
+        bool recursive = false; ///< Используется рекурсивный обход.
+        bool valid = false; ///< Папка открыта.
+        std::set<std::string> extensions; ///< Допустимые расширения.
+    };
+
+    /// \brief Последовательно отдаёт пути из нескольких источников.
+    class ChainedPathSource final : public PathSource
+    {
+    public:
+        /// \brief Добавляет источник в конец цепочки.
+        void add(std::unique_ptr<PathSource> source);
+
+        bool next(std::string& path) override;
+
+    private:
+        std::vector<std::unique_ptr<PathSource>> sources; ///< Источники в порядке обхода.
+        size_t current = 0; ///< Текущий источник.
+    };
+
+    /// \brief Разбирает список расширений через запятую, например `png,.JPG,tif`.
+    /// \return Расширения в нижнем регистре без точки.
+    std::set<std::string> parseExtensionList(const std::string& text);
+}
+
+#endif
@@ -0,0 +1,150 @@
+#include "profiler.hpp"
+#include "gldm.hpp"
+#include "resultwriter.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <string>
+
+namespace misis
+{
+    Profiler& Profiler::get()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    void Profiler::enable()
+    {
+        epoch = std::chrono::steady_clock::now();
+        enabled.store(true, std::memory_order_release);
+    }
+
+    int64_t Profiler::now() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    Profiler::ThreadEvents& Profiler::threadEvents()
+    {
+        // The buffer is owned by the profiler too, so events of finished worker threads survive until the report.
+        thread_local std::shared_ptr<ThreadEvents> events;
+        if (!events) {
+            events = std::make_shared<ThreadEvents>();
+            events->events.reserve(1024);
+            std::lock_guard lock(mutex);
+            events->threadId = static_cast<int>(threads.size()) + 1;
+            threads.push_back(events);
+        }
+        return *events;
+    }
+
+    void Profiler::record(const Event& event)
+    {
+        threadEvents().events.push_back(event);
+    }
+
+    void Profiler::printSummary(std::ostream& out) const
+    {
+        std::map<std::string, std::vector<Event>> stages;
+        int64_t first = INT64_MAX;
+        int64_t last = 0;
+        {
+            std::lock_guard lock(mutex);
+            for (const auto& thread : threads)
+                for (const Event& event : thread->events) {
+                    stages[event.stage].push_back(event);
+                    first = std::min(first, event.startNs);
+                    last = std::max(last, event.startNs + event.durationNs);
+                }
+        }
+        if (stages.empty()) {
+            out << "Profile: no stages were recorded" << std::endl;
+            return;
+        }
+        const double wallSeconds = std::max<int64_t>(last - first, 1) / 1e9;
+
+        out << "Profile over " << std::fixed << std::setprecision(3) << wallSeconds << " s:\n"
+            << std::left << std::setw(28) << "stage" << std::right << std::setw(9) << "calls"
+            << std::setw(12) << "total ms" << std::setw(10) << "p50 ms" << std::setw(10) << "p90 ms"
+            << std::setw(10) << "p99 ms" << std::setw(10) << "max ms" << std::setw(11) << "calls/s"
+            << std::setw(10) << "MPix/s" << "\n";
+        for (auto& [stage, events] : stages) {
+            std::vector<int64_t> durations;
+            int64_t totalNs = 0;
+            uint64_t pixels = 0;
+            for (const Event& event : events) {
+                durations.push_back(event.durationNs);
+                totalNs += event.durationNs;
+                pixels += event.pixels;
+            }
+            std::sort(durations.begin(), durations.end());
+            // Nearest-rank percentile.
+            const auto percentile = [&](double p) {
+                const size_t rank = static_cast<size_t>(std::ceil(p * durations.size()));
+                return durations[std::clamp<size_t>(rank, 1, durations.size()) - 1] / 1e6;
+            };
+
+            out << std::left << std::setw(28) << stage << std::right << std::setw(9) << durations.size()
+                << std::setprecision(3) << std::setw(12) << totalNs / 1e6
+                << std::setw(10) << percentile(0.50) << std::setw(10) << percentile(0.90)
+                << std::setw(10) << percentile(0.99) << std::setw(10) << durations.back() / 1e6
+                << std::setprecision(1) << std::setw(11) << durations.size() / wallSeconds;
+            // Pixel throughput is per busy thread: pixels over the time spent inside the stage.
+            if (pixels > 0 && totalNs > 0)
+                out << std::setw(10) << pixels / (totalNs / 1e9) / 1e6;
+            else
+                out << std::setw(10) << "-";
+            out << "\n";
+        }
+        out << std::defaultfloat << std::flush;
+    }
+
+    bool Profiler::saveTrace(const std::filesystem::path& path) const
+    {
+        std::ofstream file(path);
+        CheckReturn(file.is_open(), false);
+
+        std::lock_guard lock(mutex);
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        std::string line;
+        for (const auto& thread : threads)
+            for (const Event& event : thread->events) {
+                line.clear();
+                line += first ? "" : ",\n";
+                line += "{\"name\":";
+                appendJsonString(line, event.stage);
+                // Complete ("X") events; timestamps are in microseconds.
+                line += ",\"cat\":\"gldm\",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(thread->threadId)
+                    + ",\"ts\":" + std::to_string(event.startNs / 1000.0)
+                    + ",\"dur\":" + std::to_string(event.durationNs / 1000.0);
+                if (event.pixels > 0)
+                    line += ",\"args\":{\"pixels\":" + std::to_string(event.pixels) + "}";
+                line += "}";
+                file << line;
+                first = false;
+            }
+        file << "\n]}\n";
+        return static_cast<bool>(file);
+    }
+
+    ProfileSession::ProfileSession(std::filesystem::path tracePath)
+        : tracePath(std::move(tracePath))
+    {
+        Profiler::get().enable();
+    }
+
+    ProfileSession::~ProfileSession()
+    {
+        Profiler::get().printSummary(std::cerr);
+        if (tracePath.empty())
+            return;
+        if (Profiler::get().saveTrace(tracePath))
+            std::cerr << "Profile trace written to: " << tracePath.string() << std::endl;
+        else
+            std::cerr << "Failed to write profile trace: " << tracePath.string() << std::endl;
+    }
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#ifndef GLDMProfiler_2025
+#define GLDMProfiler_2025
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace misis
+{
+    /// \brief Сборщик времени стадий анализа для `--profile`.
+    ///
+    /// Стадии отмечаются `GLDM_PROFILE_SCOPE`. Пока профилирование выключено, отметка стоит
+    /// одной проверки флага; при сборке с `GLDM_DISABLE_PROFILING` отметки не компилируются вовсе.
+    /// Каждый поток пишет замеры в свой буфер, поэтому потоки конвейера не ждут друг друга.
+    class Profiler final
+    {
+    public:
+        /// \brief Один замер стадии.
+        struct Event
+        {
+            const char* stage; ///< Имя стадии (строковый литерал).
+            int64_t startNs; ///< Начало от включения профилирования, нс.
+            int64_t durationNs; ///< Длительность, нс.
+            uint64_t pixels; ///< Обработано пикселей, 0 - не известно.
+        };
+
+        /// \brief Возвращает общий для процесса сборщик.
+        static Profiler& get();
+
+        /// \brief Включает сбор замеров.
+        void enable();
+
+        /// \brief Проверяет, что сбор включён.
+        [[nodiscard]] bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+        /// \brief Время от включения профилирования в наносекундах.
+        [[nodiscard]] int64_t now() const;
+
+        /// \brief Добавляет замер текущего потока.
+        void record(const Event& event);
+
+        /// \brief Выводит по каждой стадии число вызовов, процентили задержки и пропускную способность.
+        void printSummary(std::ostream& out) const;
+
+        /// \brief Сохраняет замеры в формате Chrome `trace_event` (chrome://tracing, Perfetto).
+        /// \param[in] path Путь к JSON-файлу.
+        /// \return `false`, если файл не удалось записать.
+        bool saveTrace(const std::filesystem::path& path) const;
+
+    private:
+        /// \brief Замеры одного потока.
+        struct ThreadEvents
+        {
+            int threadId = 0; ///< Номер потока в порядке первого замера.
+            std::vector<Event> events; ///< Замеры потока.
+        };
+
+        /// \brief Буфер текущего потока, создаётся при первом замере.
+        ThreadEvents& threadEvents();
+
+        std::atomic<bool> enabled = false; ///< Сбор включён.
+        std::chrono::steady_clock::time_point epoch; ///< Момент включения.
+        mutable std::mutex mutex; ///< Защищает список буферов.
+        std::vector<std::shared_ptr<ThreadEvents>> threads; ///< Буферы всех потоков.
+    };
+
+    /// \brief Замеряет время от создания до уничтожения объекта.
+    class ScopedTimer final
+    {
+    public:
+        /// \param[in] stage Имя стадии (строковый литерал).
+        explicit ScopedTimer(const char* stage)
+            : stage(Profiler::get().isEnabled() ? stage : nullptr)
+            , start(this->stage ? Profiler::get().now() : 0)
+        {
+        }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+        ~ScopedTimer()
+        {
+            if (stage)
+                Profiler::get().record({ stage, start, Profiler::get().now() - start, pixels });
+        }
+
+        /// \brief Задаёт число обработанных пикселей для расчёта пропускной способности.
+        void setPixels(uint64_t count) { pixels = count; }
+
+    private:
+        const char* stage; ///< Стадия или `nullptr`, если профилирование выключено.
+        int64_t start; ///< Начало замера.
+        uint64_t pixels = 0; ///< Обработано пикселей.
+    };
+
+    /// \brief Включает профилирование на время жизни объекта и в конце выводит отчёт.
+    class ProfileSession final
+    {
+    public:
+        /// \param[in] tracePath Файл трассировки Chrome, пустой - не сохранять.
+        explicit ProfileSession(std::filesystem::path tracePath);
+
+        /// \brief Выводит сводку в `std::cerr` и сохраняет трассировку.
+        ~ProfileSession();
+
+    private:
+        std::filesystem::path tracePath; ///< Файл трассировки.
+    };
+}
+
+#ifdef GLDM_DISABLE_PROFILING
+#define GLDM_PROFILE_SCOPE(stage)
+#define GLDM_PROFILE_PIXELS(count)
+#else
+/// \brief Замеряет стадию до конца текущей области видимости.
+#define GLDM_PROFILE_SCOPE(stage) ::misis::ScopedTimer gldmProfileScope(stage)
+/// \brief Сообщает замеру текущей области число обработанных пикселей.
+#define GLDM_PROFILE_PIXELS(count) gldmProfileScope.setPixels(static_cast<uint64_t>(count))
+#endif
+
+#endif
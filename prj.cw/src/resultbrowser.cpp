@@ -0,0 +1,534 @@
+#include "resultbrowser.hpp"
+#include "gldm.hpp"
+#include "gldmtuner.hpp"
+#include <opencv2/highgui.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+using misis::AnalysisResult;
+
+namespace
+{
+    const std::string windowName = "GLDM Result";
+    const int gridHeader = 30; ///< Высота строки подсказки над сеткой.
+    const int labelLineHeight = 28; ///< Высота строки подписи.
+
+    /// \brief LRU-кэш отрисованных кадров, общий для окна и фонового потока.
+    class RenderCache
+    {
+    public:
+        /// \param[in] capacity Наибольшее число кадров.
+        explicit RenderCache(size_t capacity)
+            : capacity(std::max<size_t>(capacity, 1))
+        {
+        }
+
+        /// \brief Возвращает кадр и отмечает его как использованный последним.
+        /// \return `false`, если кадра нет.
+        bool get(size_t key, cv::Mat& frame)
+        {
+            std::lock_guard lock(mutex);
+            const auto it = entries.find(key);
+            if (it == entries.end())
+                return false;
+            order.splice(order.begin(), order, it->second.second);
+            frame = it->second.first;
+            return true;
+        }
+
+        /// \brief Добавляет кадр, вытесняя самые давно использованные.
+        void put(size_t key, cv::Mat frame)
+        {
+            std::lock_guard lock(mutex);
+            const auto it = entries.find(key);
+            if (it != entries.end()) {
+                it->second.first = std::move(frame);
+                order.splice(order.begin(), order, it->second.second);
+                return;
+            }
+            order.push_front(key);
+            entries.emplace(key, std::make_pair(std::move(frame), order.begin()));
+            while (entries.size() > capacity) {
+                entries.erase(order.back());
+                order.pop_back();
+            }
+        }
+
+    private:
+        size_t capacity; ///< Наибольшее число кадров.
+        std::mutex mutex; ///< Защищает список и таблицу.
+        std::list<size_t> order; ///< Ключи от последнего использованного к самому давнему.
+        std::unordered_map<size_t, std::pair<cv::Mat, std::list<size_t>::iterator>> entries; ///< Кадры по ключу.
+    };
+
+    /// \brief Изображение, сохранённое анализом, или прочитанное заново, если его нет.
+    /// \param[in] result Результат анализа.
+    /// \param[in] decodeReduction Уменьшение сторон, с которым изображение декодировал анализ.
+    cv::Mat sourceImage(const AnalysisResult& result, int decodeReduction)
+    {
+        if (!result.image.empty() || result.category == "Invalid")
+            return result.image;
+        // Results normally keep only the path, so the file is decoded the same way the analysis decoded it.
+        misis::GLDM gldm;
+        if (!gldm.loadImage(result.imageName, decodeReduction))
+            return cv::Mat();
+        return gldm.getImage();
+    }
+
+    /// \brief Изображение результата в 8-битном BGR, вписанное в `limit`.
+    ///
+    /// Большие изображения уменьшаются (`INTER_AREA`), маленькие увеличиваются в целое число раз
+    /// без сглаживания, чтобы текстура оставалась видна. Пустая матрица, если изображения нет.
+    cv::Mat fitForDisplay(const AnalysisResult& result, cv::Size limit, int decodeReduction)
+    {
+        cv::Mat image = sourceImage(result, decodeReduction);
+        if (image.empty())
+            return cv::Mat();
+
+        // Resizing first keeps the depth and colour conversions on the small image; none of them writes into the result.
+        const double scale = std::min(static_cast<double>(limit.width) / image.cols, static_cast<double>(limit.height) / image.rows);
+        if (scale < 1.0)
+            cv::resize(image, image, cv::Size(std::max(1, cvRound(image.cols * scale)), std::max(1, cvRound(image.rows * scale))),
+                0, 0, cv::INTER_AREA);
+        else if (scale >= 2.0)
+            cv::resize(image, image, cv::Size(), std::floor(scale), std::floor(scale), cv::INTER_NEAREST);
+        if (image.depth() == CV_16U)
+            image.convertTo(image, CV_8U, 1.0 / 256.0);
+
+        cv::Mat display;
+        cv::cvtColor(image, display, cv::COLOR_GRAY2BGR);
+        return display;
+    }
+
+    /// \brief Высота подложки `drawLabels` для `count` строк.
+    int labelPanelHeight(size_t count)
+    {
+        return labelLineHeight * static_cast<int>(count) + 12;
+    }
+
+    /// \brief Рисует строки текста на общей затемнённой подложке у левого края.
+    /// \param[in,out] display Кадр `CV_8UC3`.
+    /// \param[in] lines Строки текста.
+    /// \param[in] top Верхний край подложки.
+    void drawLabels(cv::Mat& display, const std::vector<std::string>& lines, int top = 0)
+    {
+        const int font = cv::FONT_HERSHEY_SIMPLEX;
+        const double fontScale = 0.6;
+        int baseline = 0;
+        int width = 0;
+        for (const std::string& line : lines)
+            width = std::max(width, cv::getTextSize(line, font, fontScale, 1, &baseline).width);
+
+        // One darkened panel in place, instead of a blended copy per label.
+        cv::Rect panel(0, top, width + 20, labelPanelHeight(lines.size()));
+        panel &= cv::Rect(0, 0, display.cols, display.rows);
+        cv::Mat roi = display(panel);
+        roi.convertTo(roi, -1, 0.5);
+
+        for (size_t k = 0; k < lines.size(); ++k)
+            cv::putText(display, lines[k], cv::Point(10, top + labelLineHeight * (static_cast<int>(k) + 1)), font, fontScale,
+                cv::Scalar(255, 255, 255), 1, cv::LINE_AA);
+    }
+
+    /// \brief Число строк подписи результата в `renderView`.
+    const size_t viewLabelLines = 5;
+
+    /// \brief Отрисовывает результат для просмотра по одному.
+    cv::Mat renderView(const AnalysisResult& result, size_t index, size_t count, cv::Size limit, int decodeReduction)
+    {
+        cv::Mat display = fitForDisplay(result, limit, decodeReduction);
+        if (display.empty() || display.cols < 640 || display.rows < 340) {
+            // Small or missing images get a canvas large enough for the result and the live tuning labels.
+            cv::Mat canvas(std::max(display.rows, 340), std::max(display.cols, 640), CV_8UC3, cv::Scalar(0, 0, 0));
+            if (!display.empty())
+                display.copyTo(canvas(cv::Rect(0, 0, display.cols, display.rows)));
+            display = canvas;
+        }
+
+        drawLabels(display, {
+            "[" + std::to_string(index + 1) + "/" + std::to_string(count) + "] " + result.imageName,
+            "alpha: " + std::to_string(static_cast<int>(result.alpha)) + "  delta: " + std::to_string(static_cast<int>(result.delta)),
+            "LGLE: " + std::to_string(result.LGLE),
+            "DN: " + std::to_string(result.DN),
+            "Category: " + result.category,
+        });
+        return display;
+    }
+
+    /// \brief Отрисовывает миниатюру с подписью в квадратной ячейке.
+    cv::Mat renderThumbnail(const AnalysisResult& result, int size, int decodeReduction)
+    {
+        const int caption = 18;
+        cv::Mat cell(size, size, CV_8UC3, cv::Scalar(40, 40, 40));
+        const cv::Mat image = fitForDisplay(result, cv::Size(size - 4, size - caption - 4), decodeReduction);
+        if (!image.empty())
+            image.copyTo(cell(cv::Rect((size - image.cols) / 2, 2 + (size - caption - 4 - image.rows) / 2, image.cols, image.rows)));
+
+        const size_t slash = result.imageName.find_last_of("/\\");
+        std::string name = slash == std::string::npos ? result.imageName : result.imageName.substr(slash + 1);
+        int baseline = 0;
+        while (name.size() > 4 && cv::getTextSize(name, cv::FONT_HERSHEY_SIMPLEX, 0.4, 1, &baseline).width > size - 6)
+            name = name.substr(0, name.size() - 4) + "..";
+        cv::putText(cell, name, cv::Point(3, size - 5), cv::FONT_HERSHEY_SIMPLEX, 0.4, cv::Scalar(255, 255, 255), 1, cv::LINE_AA);
+        return cell;
+    }
+
+    /// \brief Действие пользователя.
+    enum class Action
+    {
+        None,
+        Previous,
+        Next,
+        Up,
+        Down,
+        Open,
+        Toggle,
+        Quit
+    };
+
+    /// \brief Переводит код клавиши `cv::waitKeyEx` в действие.
+    Action decodeKey(int key)
+    {
+        switch (key) {
+        case 27: case 'q': case 'Q': return Action::Quit;
+        case 13: case 10: return Action::Open;
+        case 9: case 'g': case 'G': return Action::Toggle;
+        // Arrow codes differ between the GTK, Windows, Qt and Cocoa backends.
+        case 65361: case 0x250000: case 0x1000012: case 63234: case 'a': case 'A': case 'p': return Action::Previous;
+        case 65363: case 0x270000: case 0x1000014: case 63235: case 'd': case 'D': case 'n': case ' ': return Action::Next;
+        case 65362: case 0x260000: case 0x1000013: case 63232: case 'w': case 'W': return Action::Up;
+        case 65364: case 0x280000: case 0x1000015: case 63233: case 's': case 'S': return Action::Down;
+        default: return Action::None;
+        }
+    }
+
+    /// \brief Окно просмотра с фоновой подготовкой кадров.
+    class ResultBrowser
+    {
+    public:
+        ResultBrowser(const std::vector<AnalysisResult>& results, const misis::BrowserOptions& browserOptions)
+            : results(results)
+            , options(browserOptions)
+            , views(browserOptions.cachedViews)
+            , thumbnails(browserOptions.cachedThumbnails)
+        {
+            options.gridColumns = std::max(options.gridColumns, 1);
+            options.gridRows = std::max(options.gridRows, 1);
+            options.thumbnailSize = std::max(options.thumbnailSize, 48);
+            options.prefetchRadius = std::max(options.prefetchRadius, 0);
+            gridMode = results.size() > 1;
+            worker = std::thread([this] { prefetchLoop(); });
+        }
+
+        ~ResultBrowser()
+        {
+            {
+                std::lock_guard lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            worker.join();
+        }
+
+        /// \brief Показывает окно до выхода пользователя или закрытия окна.
+        void run()
+        {
+            cv::namedWindow(windowName, cv::WINDOW_AUTOSIZE);
+            cv::setMouseCallback(windowName, &ResultBrowser::onMouse, this);
+
+            // The sliders start at the parameters of the analysis; moving one switches the view to live values.
+            const int alphaMax = std::clamp(options.quantization.grayLevels - 1, 1, 1023);
+            const int deltaMax = std::max(options.maxDelta, 1);
+            cv::createTrackbar("alpha", windowName, nullptr, alphaMax, &ResultBrowser::onTrackbar, this);
+            cv::createTrackbar("delta", windowName, nullptr, deltaMax, &ResultBrowser::onTrackbar, this);
+            cv::setTrackbarPos("alpha", windowName, std::clamp(static_cast<int>(results[current].alpha), 0, alphaMax));
+            cv::setTrackbarPos("delta", windowName, std::clamp(static_cast<int>(results[current].delta), 0, deltaMax));
+            slidersMoved = false;
+
+            bool complete = false;
+            bool redraw = true;
+            while (true) {
+                if (slidersMoved) {
+                    slidersMoved = false;
+                    tuning = true;
+                    redraw = true;
+                }
+                // Live values are computed for the open image only, right before it is drawn.
+                if (tuning && !gridMode && retune())
+                    redraw = true;
+
+                // An incomplete frame is redrawn whenever the prefetcher finishes something.
+                if (redraw || (!complete && rendered.exchange(false))) {
+                    cv::Mat frame;
+                    complete = compose(frame);
+                    cv::imshow(windowName, frame);
+                    redraw = false;
+                }
+
+                const int key = cv::waitKeyEx(30);
+                if (clicked >= 0) {
+                    select(static_cast<size_t>(clicked), false);
+                    clicked = -1;
+                    redraw = true;
+                    continue;
+                }
+                if (key == -1) {
+                    if (cv::getWindowProperty(windowName, cv::WND_PROP_VISIBLE) < 1)
+                        break;
+                    continue;
+                }
+
+                const Action action = decodeKey(key);
+                const size_t last = results.size() - 1;
+                const size_t columns = static_cast<size_t>(options.gridColumns);
+                if (action == Action::Quit)
+                    break;
+                if (action == Action::Toggle)
+                    select(current, !gridMode);
+                else if (action == Action::Open && gridMode)
+                    select(current, false);
+                else if (action == Action::Previous && current > 0)
+                    select(current - 1, gridMode);
+                else if (action == Action::Next && current < last)
+                    select(current + 1, gridMode);
+                else if (action == Action::Up && gridMode && current >= columns)
+                    select(current - columns, gridMode);
+                else if (action == Action::Down && gridMode && current + columns <= last)
+                    select(current + columns, gridMode);
+                else
+                    continue;
+                redraw = true;
+            }
+            cv::destroyWindow(windowName);
+        }
+
+    private:
+        /// \brief Число миниатюр на странице.
+        size_t pageSize() const { return static_cast<size_t>(options.gridColumns) * options.gridRows; }
+
+        /// \brief Делает изображение текущим и перезапускает подготовку кадров вокруг него.
+        void select(size_t index, bool grid)
+        {
+            {
+                std::lock_guard lock(mutex);
+                current = std::min(index, results.size() - 1);
+                gridMode = grid;
+                ++generation;
+            }
+            wake.notify_one();
+        }
+
+        /// \brief Собирает кадр для текущего состояния из готовых кадров.
+        /// \return `false`, если часть кадра ещё не готова и показана заглушкой.
+        bool compose(cv::Mat& frame)
+        {
+            if (!gridMode) {
+                cv::Mat view;
+                if (!views.get(current, view)) {
+                    frame = cv::Mat(200, 640, CV_8UC3, cv::Scalar(0, 0, 0));
+                    drawLabels(frame, { "Loading " + results[current].imageName + " ..." });
+                    return false;
+                }
+                frame = view;
+                if (tuning && tuned.index == current) {
+                    // Cached frames are shared with the prefetcher, so the live labels go on a copy.
+                    frame = view.clone();
+                    drawLabels(frame, tuned.lines, labelPanelHeight(viewLabelLines) + 4);
+                }
+                return true;
+            }
+
+            const int size = options.thumbnailSize;
+            const size_t page = current / pageSize();
+            const size_t pages = (results.size() + pageSize() - 1) / pageSize();
+            frame = cv::Mat(gridHeader + options.gridRows * size, options.gridColumns * size, CV_8UC3, cv::Scalar(20, 20, 20));
+            cv::putText(frame, "Page " + std::to_string(page + 1) + "/" + std::to_string(pages)
+                + "   arrows: select   Enter/click: open   g: grid/view   q: quit",
+                cv::Point(8, 20), cv::FONT_HERSHEY_SIMPLEX, 0.45, cv::Scalar(255, 255, 255), 1, cv::LINE_AA);
+
+            bool complete = true;
+            for (size_t k = 0; k < pageSize() && page * pageSize() + k < results.size(); ++k) {
+                const size_t index = page * pageSize() + k;
+                const cv::Rect cell(static_cast<int>(k % options.gridColumns) * size,
+                    gridHeader + static_cast<int>(k / options.gridColumns) * size, size, size);
+                cv::Mat thumbnail;
+                if (thumbnails.get(index, thumbnail))
+                    thumbnail.copyTo(frame(cell));
+                else
+                    complete = false;
+                if (index == current)
+                    cv::rectangle(frame, cell, cv::Scalar(0, 200, 255), 2);
+            }
+            return complete;
+        }
+
+        /// \brief Пересчитывает признаки открытого изображения, если сменились изображение или ползунки.
+        /// \return `true`, если подписи изменились.
+        bool retune()
+        {
+            const int alpha = cv::getTrackbarPos("alpha", windowName);
+            const int delta = cv::getTrackbarPos("delta", windowName);
+            if (tuned.index == current && tuned.alpha == alpha && tuned.delta == delta)
+                return false;
+
+            if (tuned.index != current) {
+                // Differences are prepared once per image; further slider moves only compare them with the threshold.
+                tuned.index = current;
+                tunerReady = tuner.setImage(sourceImage(results[current], options.decodeReduction), options.quantization);
+            }
+            tuned.alpha = alpha;
+            tuned.delta = delta;
+            if (!tunerReady) {
+                tuned.lines = { "Live values: the image could not be read" };
+                return true;
+            }
+            // The sliders stay on screen for the other images, but this one would not fit the plane memory.
+            if (tuner.maxRadius() < 1) {
+                tuned.lines = { "Live values: the image is too large, sliders are disabled for it" };
+                return true;
+            }
+
+            const int radius = std::min(delta, tuner.maxRadius());
+            const auto start = std::chrono::steady_clock::now();
+            const misis::GLDMFeatureSet features = misis::GLDMExtractor::scaleToFullResolution(
+                tuner.computeMatrix(static_cast<misis::Real>(radius), static_cast<misis::Real>(alpha), options.threads).computeAllFeatures(),
+                options.decodeReduction);
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            tuned.lines = {
+                "Live alpha: " + std::to_string(alpha) + "  delta: " + std::to_string(radius)
+                    + (radius < delta ? " (largest for this image)" : "") + "  " + std::to_string(cvRound(ms)) + " ms",
+                "LGLE: " + std::to_string(features.LGLE),
+                "DN: " + std::to_string(features.DN),
+                "Category: " + misis::GLDMExtractor::classify(features.LGLE, features.DN),
+            };
+            return true;
+        }
+
+        /// \brief Фоновый поток: отрисовывает кадры, которые понадобятся скорее всего.
+        void prefetchLoop()
+        {
+            uint64_t seen = 0;
+            while (true) {
+                size_t center = 0;
+                bool grid = false;
+                {
+                    std::unique_lock lock(mutex);
+                    wake.wait(lock, [&] { return stopping || generation != seen; });
+                    if (stopping)
+                        return;
+                    seen = generation;
+                    center = current;
+                    grid = gridMode;
+                }
+
+                // Jobs go from the most to the least urgent: (is thumbnail, result index).
+                std::vector<std::pair<bool, size_t>> jobs;
+                const auto addView = [&](int64_t index) {
+                    if (index >= 0 && index < static_cast<int64_t>(results.size()))
+                        jobs.push_back({ false, static_cast<size_t>(index) });
+                };
+                const auto addPage = [&](int64_t page) {
+                    for (size_t k = 0; page >= 0 && k < pageSize() && page * pageSize() + k < results.size(); ++k)
+                        jobs.push_back({ true, page * pageSize() + k });
+                };
+                const int64_t page = static_cast<int64_t>(center / pageSize());
+                if (grid) {
+                    addPage(page);
+                    addPage(page + 1);
+                    addPage(page - 1);
+                    addView(static_cast<int64_t>(center));
+                }
+                else {
+                    addView(static_cast<int64_t>(center));
+                    for (int r = 1; r <= options.prefetchRadius; ++r) {
+                        addView(static_cast<int64_t>(center) + r);
+                        addView(static_cast<int64_t>(center) - r);
+                    }
+                    addPage(page);
+                }
+
+                for (const auto& [thumbnail, index] : jobs) {
+                    {
+                        // A new selection makes the rest of the plan stale.
+                        std::lock_guard lock(mutex);
+                        if (stopping || generation != seen)
+                            break;
+                    }
+                    RenderCache& cache = thumbnail ? thumbnails : views;
+                    cv::Mat cached;
+                    // Looking an entry up also keeps the neighbours of the current image from being evicted.
+                    if (cache.get(index, cached))
+                        continue;
+                    cache.put(index, thumbnail
+                        ? renderThumbnail(results[index], options.thumbnailSize, options.decodeReduction)
+                        : renderView(results[index], index, results.size(), options.maxView, options.decodeReduction));
+                    rendered = true;
+                }
+            }
+        }
+
+        /// \brief Щелчок по миниатюре открывает её; вызывается в потоке окна.
+        static void onMouse(int event, int x, int y, int, void* data)
+        {
+            ResultBrowser& browser = *static_cast<ResultBrowser*>(data);
+            if (event != cv::EVENT_LBUTTONDOWN || !browser.gridMode || y < gridHeader)
+                return;
+            const int column = x / browser.options.thumbnailSize;
+            const int row = (y - gridHeader) / browser.options.thumbnailSize;
+            if (column >= browser.options.gridColumns || row >= browser.options.gridRows)
+                return;
+            const size_t index = browser.current / browser.pageSize() * browser.pageSize()
+                + static_cast<size_t>(row) * browser.options.gridColumns + column;
+            if (index < browser.results.size())
+                browser.clicked = static_cast<int64_t>(index);
+        }
+
+        /// \brief Ползунок сдвинут; вызывается в потоке окна.
+        static void onTrackbar(int, void* data)
+        {
+            static_cast<ResultBrowser*>(data)->slidersMoved = true;
+        }
+
+        /// \brief Признаки открытого изображения, пересчитанные с ползунками.
+        struct TunedResult
+        {
+            size_t index = SIZE_MAX; ///< Изображение, для которого подготовлен `tuner`.
+            int alpha = -1; ///< Положение ползунка alpha при пересчёте.
+            int delta = -1; ///< Положение ползунка delta при пересчёте.
+            std::vector<std::string> lines; ///< Подписи с пересчитанными признаками.
+        };
+
+        const std::vector<AnalysisResult>& results; ///< Показываемые результаты.
+        misis::BrowserOptions options; ///< Параметры окна.
+        RenderCache views; ///< Кадры просмотра по одному.
+        RenderCache thumbnails; ///< Миниатюры.
+        std::mutex mutex; ///< Защищает выбор и флаг остановки для фонового потока.
+        std::condition_variable wake; ///< Будит фоновый поток при смене выбора.
+        size_t current = 0; ///< Текущее изображение; меняется только потоком окна.
+        bool gridMode = true; ///< Показывается сетка миниатюр.
+        uint64_t generation = 1; ///< Номер выбора, растёт при каждой смене.
+        bool stopping = false; ///< Фоновый поток должен завершиться.
+        std::atomic<bool> rendered = false; ///< Фоновый поток подготовил новый кадр.
+        int64_t clicked = -1; ///< Миниатюра, по которой щёлкнули, -1 - нет.
+        bool slidersMoved = false; ///< Ползунок сдвинут с прошлой проверки.
+        bool tuning = false; ///< Показываются признаки, пересчитанные с ползунками.
+        misis::GLDMTuner tuner; ///< Разности с соседями открытого изображения; используется только потоком окна.
+        bool tunerReady = false; ///< Изображение для `tuner` прочитано.
+        TunedResult tuned; ///< Последний пересчёт.
+        std::thread worker; ///< Фоновый поток подготовки кадров.
+    };
+}
+
+void misis::browseResults(const std::vector<AnalysisResult>& results, const BrowserOptions& options)
+{
+    CheckReturn_Void(!results.empty());
+    ResultBrowser browser(results, options);
+    browser.run();
+}
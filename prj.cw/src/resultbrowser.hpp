@@ -0,0 +1,45 @@
+#pragma once
+
+#ifndef GLDMResultBrowser_2025
+#define GLDMResultBrowser_2025
+
+#include <vector>
+#include "extractor.hpp"
+
+namespace misis
+{
+    /// \brief Параметры окна просмотра результатов.
+    struct BrowserOptions
+    {
+        int prefetchRadius = 4; ///< Сколько соседних изображений с каждой стороны готовится заранее.
+        size_t cachedViews = 32; ///< Сколько подготовленных изображений держится в памяти.
+        size_t cachedThumbnails = 512; ///< Сколько миниатюр держится в памяти.
+        int gridColumns = 5; ///< Столбцов в сетке миниатюр.
+        int gridRows = 4; ///< Строк в сетке миниатюр.
+        int thumbnailSize = 200; ///< Сторона ячейки миниатюры в пикселях.
+        cv::Size maxView = { 1280, 900 }; ///< Наибольший размер изображения при просмотре по одному.
+        GLDMQuantization quantization; ///< Квантование для пересчёта с ползунками alpha и delta.
+        int threads = 0; ///< Потоки пересчёта с ползунками (0 - все ядра).
+        int maxDelta = 8; ///< Наибольшее значение ползунка delta.
+        int decodeReduction = 1; ///< Уменьшение сторон при декодировании, как при анализе (`GLDMExtractor::setDecodeReduction`).
+    };
+
+    /// \brief Показывает результаты анализа: сетка миниатюр и просмотр по одному.
+    ///
+    /// Окно не ждёт подготовки изображений: фоновый поток заранее отрисовывает соседей текущего
+    /// изображения и миниатюры соседних страниц, а готовые кадры хранятся в LRU-кэше. Результаты
+    /// обычно хранят только путь: файл декодируется фоновым потоком по мере надобности, поэтому память
+    /// не растёт с числом результатов. Изображение, сохранённое анализом (`GLDMExtractor::setKeepImages`),
+    /// используется без повторного чтения.
+    ///
+    /// Клавиши: стрелки, `a`/`d`/`w`/`s` или пробел - перемещение, `Enter` - открыть выбранное,
+    /// `g` или `Tab` - переключить сетку и просмотр, `q` или `Esc` - выход. Миниатюру можно открыть щелчком.
+    ///
+    /// Ползунки alpha и delta пересчитывают LGLE, DN и категорию открытого изображения (`GLDMTuner`):
+    /// разности с соседями считаются один раз на изображение, и смена alpha их только заново сравнивает с порогом.
+    /// \param[in] results Результаты анализа.
+    /// \param[in] options Параметры окна.
+    void browseResults(const std::vector<AnalysisResult>& results, const BrowserOptions& options = {});
+}
+
+#endif
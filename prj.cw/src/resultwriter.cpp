@@ -0,0 +1,347 @@
+#include "resultwriter.hpp"
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace misis;
+
+namespace
+{
+    /// \brief Размер буфера выходного потока.
+    constexpr size_t streamBufferSize = 1 << 20;
+
+    constexpr char binaryMagic[8] = { 'G', 'L', 'D', 'M', 'R', 'E', 'S', '1' };
+
+    /// \brief Дописывает число в кратчайшей записи, которая читается обратно без потерь.
+    void appendNumber(std::string& out, double value)
+    {
+        char digits[32];
+        const auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value);
+        out.append(digits, error == std::errc() ? end : digits);
+    }
+
+    /// \brief Дописывает число JSON; NaN и бесконечность в JSON не представимы и пишутся как `null`.
+    void appendJsonNumber(std::string& out, double value)
+    {
+        if (std::isfinite(value))
+            appendNumber(out, value);
+        else
+            out += "null";
+    }
+
+    template <typename T>
+    void appendBinary(std::string& out, const T& value)
+    {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    /// \brief Прежний вывод: txt-сводка на изображение или `sweep_summary.csv` после перебора.
+    class TextResultWriter final : public ResultWriter
+    {
+    public:
+        TextResultWriter(const GLDMExtractor& extractor, const std::filesystem::path& outputDir, bool sweep)
+            : extractor(extractor)
+            , outputDir(outputDir.string())
+            , sweep(sweep)
+        {
+        }
+
+        void write(const AnalysisResult& result) override
+        {
+            if (sweep)
+                sweepResults.push_back(result);
+            else
+                extractor.saveSummary(result, outputDir);
+        }
+
+        bool close() override
+        {
+            if (sweep && !sweepResults.empty())
+                extractor.saveSweepSummary(sweepResults, outputDir);
+            sweepResults.clear();
+            return true;
+        }
+
+    private:
+        const GLDMExtractor& extractor;
+        std::string outputDir;
+        bool sweep;
+        std::vector<AnalysisResult> sweepResults; ///< Таблица перебора пишется целиком в конце.
+    };
+
+    /// \brief Общая часть форматов с одним буферизованным потоком: открытие частей и подсчёт записей.
+    class StreamResultWriter : public ResultWriter
+    {
+    public:
+        StreamResultWriter(const std::filesystem::path& outputDir, std::string extension, uint64_t shardSize)
+            : outputDir(outputDir)
+            , extension(std::move(extension))
+            , shardSize(shardSize)
+            , buffer(streamBufferSize)
+        {
+        }
+
+        void write(const AnalysisResult& result) override
+        {
+            if (result.category == "Invalid" || failed)
+                return;
+            if (!file.is_open() || (shardSize > 0 && shardRecords == shardSize)) {
+                if (!openShard())
+                    return;
+            }
+
+            record.clear();
+            formatRecord(record, result);
+            file.write(record.data(), static_cast<std::streamsize>(record.size()));
+            ++shardRecords;
+        }
+
+        bool close() override
+        {
+            closeShard();
+            return !failed;
+        }
+
+    protected:
+        /// \brief Дописывает начало файла (заголовок таблицы, сигнатуру).
+        virtual void formatHeader(std::string& out) const = 0;
+
+        /// \brief Дописывает одну запись.
+        virtual void formatRecord(std::string& out, const AnalysisResult& result) const = 0;
+
+    private:
+        bool openShard()
+        {
+            closeShard();
+            if (failed)
+                return false;
+
+            std::string name = "results";
+            if (shardSize > 0) {
+                char index[16];
+                std::snprintf(index, sizeof(index), "-%05u", shardIndex++);
+                name += index;
+            }
+            path = outputDir / (name + extension);
+
+            // The buffer has to be installed before the file is opened to take effect.
+            file.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            file.open(path, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                std::cerr << "Could not open the results file: " << path.string() << std::endl;
+                failed = true;
+                return false;
+            }
+
+            shardRecords = 0;
+            record.clear();
+            formatHeader(record);
+            file.write(record.data(), static_cast<std::streamsize>(record.size()));
+            return true;
+        }
+
+        void closeShard()
+        {
+            if (!file.is_open())
+                return;
+            file.close();
+            if (!file) {
+                std::cerr << "Could not write the results file: " << path.string() << std::endl;
+                failed = true;
+                return;
+            }
+            std::cout << "Results written to: " << path.string() << '\n';
+        }
+
+        std::filesystem::path outputDir;
+        std::string extension; ///< Расширение файла с точкой.
+        uint64_t shardSize; ///< Записей в части, 0 - без разбиения.
+        std::vector<char> buffer; ///< Буфер потока.
+        std::ofstream file; ///< Текущая часть.
+        std::filesystem::path path; ///< Путь текущей части.
+        std::string record; ///< Переиспользуемый буфер записи.
+        uint64_t shardRecords = 0; ///< Записей в текущей части.
+        unsigned shardIndex = 0; ///< Номер следующей части.
+        bool failed = false; ///< Файл не удалось открыть или записать.
+    };
+
+    class CsvResultWriter final : public StreamResultWriter
+    {
+    public:
+        CsvResultWriter(const std::filesystem::path& outputDir, uint64_t shardSize)
+            : StreamResultWriter(outputDir, ".csv", shardSize)
+        {
+        }
+
+    protected:
+        void formatHeader(std::string& out) const override
+        {
+            out += "image,alpha,delta";
+            for (const std::string_view name : GLDMFeatureSet::names) {
+                out += ',';
+                out += name;
+            }
+            out += ",category\n";
+        }
+
+        void formatRecord(std::string& out, const AnalysisResult& result) const override
+        {
+            appendCsvField(out, result.imageName);
+            out += ',';
+            appendNumber(out, result.alpha);
+            out += ',';
+            appendNumber(out, result.delta);
+            for (const double value : result.features.values()) {
+                out += ',';
+                appendNumber(out, value);
+            }
+            out += ',';
+            appendCsvField(out, result.category);
+            out += '\n';
+        }
+    };
+
+    class JsonLinesResultWriter final : public StreamResultWriter
+    {
+    public:
+        JsonLinesResultWriter(const std::filesystem::path& outputDir, uint64_t shardSize)
+            : StreamResultWriter(outputDir, ".jsonl", shardSize)
+        {
+        }
+
+    protected:
+        void formatHeader(std::string&) const override
+        {
+        }
+
+        void formatRecord(std::string& out, const AnalysisResult& result) const override
+        {
+            appendJsonResult(out, result);
+            out += '\n';
+        }
+    };
+
+    class BinaryResultWriter final : public StreamResultWriter
+    {
+    public:
+        BinaryResultWriter(const std::filesystem::path& outputDir, uint64_t shardSize)
+            : StreamResultWriter(outputDir, ".bin", shardSize)
+        {
+        }
+
+    protected:
+        void formatHeader(std::string& out) const override
+        {
+            out.append(binaryMagic, sizeof(binaryMagic));
+            appendBinary(out, static_cast<uint32_t>(GLDMFeatureSet::size));
+        }
+
+        void formatRecord(std::string& out, const AnalysisResult& result) const override
+        {
+            appendBinary(out, static_cast<uint32_t>(result.imageName.size()));
+            appendBinary(out, static_cast<uint32_t>(result.category.size()));
+            appendBinary(out, static_cast<double>(result.alpha));
+            appendBinary(out, static_cast<double>(result.delta));
+            for (const double value : result.features.values())
+                appendBinary(out, value);
+            out += result.imageName;
+            out += result.category;
+        }
+    };
+}
+
+void misis::appendCsvField(std::string& out, std::string_view field)
+{
+    if (field.find_first_of(",\"\r\n") == std::string_view::npos) {
+        out += field;
+        return;
+    }
+    out += '"';
+    for (const char c : field) {
+        if (c == '"')
+            out += '"';
+        out += c;
+    }
+    out += '"';
+}
+
+void misis::appendJsonString(std::string& out, std::string_view text)
+{
+    out += '"';
+    for (const char c : text) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                out += escaped;
+            }
+            else {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+void misis::appendJsonResult(std::string& out, const AnalysisResult& result, std::string_view prefix)
+{
+    out += '{';
+    out += prefix;
+    out += "\"image\":";
+    appendJsonString(out, result.imageName);
+    out += ",\"alpha\":";
+    appendJsonNumber(out, result.alpha);
+    out += ",\"delta\":";
+    appendJsonNumber(out, result.delta);
+    out += ",\"features\":{";
+    const auto values = result.features.values();
+    for (size_t k = 0; k < GLDMFeatureSet::size; ++k) {
+        if (k > 0)
+            out += ',';
+        out += '"';
+        out += GLDMFeatureSet::names[k];
+        out += "\":";
+        appendJsonNumber(out, values[k]);
+    }
+    out += "},\"category\":";
+    appendJsonString(out, result.category);
+    out += '}';
+}
+
+bool misis::parseResultFormat(const std::string& name, ResultFormat& format)
+{
+    if (name == "txt")
+        format = ResultFormat::Text;
+    else if (name == "csv")
+        format = ResultFormat::Csv;
+    else if (name == "jsonl")
+        format = ResultFormat::JsonLines;
+    else if (name == "bin")
+        format = ResultFormat::Binary;
+    else
+        return false;
+    return true;
+}
+
+std::unique_ptr<ResultWriter> ResultWriter::create(ResultFormat format, const GLDMExtractor& extractor,
+    const std::filesystem::path& outputDir, bool sweep, uint64_t shardSize)
+{
+    switch (format) {
+    case ResultFormat::Text:
+        return std::make_unique<TextResultWriter>(extractor, outputDir, sweep);
+    case ResultFormat::JsonLines:
+        return std::make_unique<JsonLinesResultWriter>(outputDir, shardSize);
+    case ResultFormat::Binary:
+        return std::make_unique<BinaryResultWriter>(outputDir, shardSize);
+    case ResultFormat::Csv:
+    default:
+        return std::make_unique<CsvResultWriter>(outputDir, shardSize);
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#ifndef GLDMResultWriter_2025
+#define GLDMResultWriter_2025
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "extractor.hpp"
+
+namespace misis
+{
+    /// \brief Формат файла результатов анализа.
+    enum class ResultFormat
+    {
+        Text, ///< Отдельная txt-сводка на изображение (для перебора параметров - `sweep_summary.csv`).
+        Csv, ///< Таблица CSV, строка на результат.
+        JsonLines, ///< JSON Lines, объект на результат.
+        Binary ///< Двоичные записи фиксированного вида, см. `ResultWriter`.
+    };
+
+    /// \brief Разбирает имя формата из командной строки: `txt`, `csv`, `jsonl` или `bin`.
+    /// \param[in] name Имя формата.
+    /// \param[out] format Формат.
+    /// \return `false`, если имя неизвестно.
+    bool parseResultFormat(const std::string& name, ResultFormat& format);
+
+    /// \brief Дописывает поле CSV, при необходимости в кавычках.
+    void appendCsvField(std::string& out, std::string_view field);
+
+    /// \brief Дописывает строку JSON в кавычках с экранированием.
+    void appendJsonString(std::string& out, std::string_view text);
+
+    /// \brief Дописывает результат как объект JSON, как в записях `ResultFormat::JsonLines`, без перевода строки.
+    /// \param[in,out] out Строка, к которой дописывается объект.
+    /// \param[in] result Результат анализа.
+    /// \param[in] prefix Готовые поля, вставляемые первыми, например `"id":1,`.
+    void appendJsonResult(std::string& out, const AnalysisResult& result, std::string_view prefix = {});
+
+    /// \brief Записывает результаты анализа всех изображений в один файл (или в несколько частей).
+    ///
+    /// Все результаты идут в один поток с большим буфером, поэтому запись не открывает файл
+    /// и не сбрасывает буфер на каждое изображение. Файл называется `results.<ext>`, а при
+    /// разбиении на части - `results-00000.<ext>`, `results-00001.<ext>` и т. д.
+    ///
+    /// Каждая запись содержит имя изображения, alpha, delta, все признаки `GLDMFeatureSet`
+    /// и категорию. Двоичный файл начинается с заголовка `GLDMRES1` и числа признаков (uint32),
+    /// затем записи: uint32 длина имени, uint32 длина категории, alpha, delta и признаки (double),
+    /// имя и категория без завершающего нуля. Порядок байтов - как у машины, записавшей файл.
+    ///
+    /// Результаты с категорией "Invalid" не записываются.
+    class ResultWriter
+    {
+    public:
+        virtual ~ResultWriter() = default;
+
+        /// \brief Создаёт писатель результатов.
+        /// \param[in] format Формат файла.
+        /// \param[in] extractor Анализатор, сохраняющий txt-сводки для `ResultFormat::Text`.
+        /// \param[in] outputDir Папка для сохранения.
+        /// \param[in] sweep Результаты получены перебором параметров.
+        /// \param[in] shardSize Наибольшее число записей в одном файле, 0 - один файл.
+        static std::unique_ptr<ResultWriter> create(ResultFormat format, const GLDMExtractor& extractor,
+            const std::filesystem::path& outputDir, bool sweep, uint64_t shardSize = 0);
+
+        /// \brief Добавляет результат.
+        virtual void write(const AnalysisResult& result) = 0;
+
+        /// \brief Дописывает и закрывает файлы.
+        /// \return `false`, если запись не удалась.
+        virtual bool close() = 0;
+    };
+}
+
+#endif
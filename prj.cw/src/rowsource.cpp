@@ -0,0 +1,121 @@
+#include "rowsource.hpp"
+#include <cctype>
+#include <limits>
+#include <string>
+
+using namespace misis;
+
+namespace
+{
+    constexpr size_t streamBufferSize = 1 << 20; ///< Размер полосы, читаемой из файла за один раз.
+
+    /// \brief Читает следующее число заголовка PNM, пропуская пробелы и комментарии.
+    /// \param[in] get Возвращает следующий байт заголовка или `EOF`.
+    template <typename Get>
+    bool readHeaderValue(Get&& get, int& value)
+    {
+        int c = get();
+        while (c != EOF) {
+            if (c == '#') {
+                while (c != EOF && c != '\n')
+                    c = get();
+            }
+            else if (!std::isspace(c)) {
+                break;
+            }
+            c = get();
+        }
+        if (c == EOF || !std::isdigit(c))
+            return false;
+
+        long long result = 0;
+        while (c != EOF && std::isdigit(c)) {
+            result = result * 10 + (c - '0');
+            if (result > std::numeric_limits<int>::max())
+                return false;
+            c = get();
+        }
+        // Exactly one whitespace character separates the last header value from the pixel data.
+        if (c == EOF || !std::isspace(c))
+            return false;
+
+        value = static_cast<int>(result);
+        return true;
+    }
+
+    /// \brief Разбирает размеры и maxval после сигнатуры `P5`.
+    template <typename Get>
+    bool readPgmHeader(Get&& get, PgmHeader& header)
+    {
+        if (get() != 'P' || get() != '5')
+            return false;
+        if (!readHeaderValue(get, header.width) || !readHeaderValue(get, header.height) || !readHeaderValue(get, header.maxValue))
+            return false;
+        return header.width > 0 && header.height > 0 && header.maxValue > 0 && header.maxValue <= 65535;
+    }
+}
+
+PgmRowSource::PgmRowSource(const std::filesystem::path& path)
+    : buffer(streamBufferSize)
+{
+    file.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    file.open(path, std::ios::binary);
+    if (!file.is_open())
+        return;
+
+    PgmHeader header;
+    if (!readPgmHeader([&] { return file.get(); }, header))
+        return;
+
+    width = header.width;
+    height = header.height;
+    wide = header.maxValue > 255;
+    valid = true;
+}
+
+bool PgmRowSource::isOpen() const
+{
+    return valid;
+}
+
+bool PgmRowSource::readRow(uchar* row)
+{
+    if (!valid)
+        return false;
+    file.read(reinterpret_cast<char*>(row), static_cast<std::streamsize>(width) * (wide ? 2 : 1));
+    if (!file)
+        return false;
+
+    // 16-bit PGM samples are stored most significant byte first.
+    if (wide) {
+        for (int x = 0; x < width; ++x) {
+            const uchar high = row[2 * x];
+            const uchar low = row[2 * x + 1];
+            reinterpret_cast<ushort*>(row)[x] = static_cast<ushort>((high << 8) | low);
+        }
+    }
+    return true;
+}
+
+bool misis::parsePgmHeader(const uchar* data, size_t size, PgmHeader& header)
+{
+    size_t position = 0;
+    if (!readPgmHeader([&]() -> int { return position < size ? data[position++] : EOF; }, header))
+        return false;
+    header.dataOffset = position;
+    return true;
+}
+
+std::unique_ptr<RowSource> misis::openRowSource(const std::filesystem::path& path)
+{
+    std::string extension = path.extension().string();
+    for (char& c : extension)
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    if (extension != ".pgm" && extension != ".pnm")
+        return nullptr;
+
+    auto source = std::make_unique<PgmRowSource>(path);
+    if (!source->isOpen())
+        return nullptr;
+    return source;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#ifndef GLDMRowSource_2025
+#define GLDMRowSource_2025
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
+#include <opencv2/core.hpp>
+
+namespace misis
+{
+    /// \brief Источник строк изображения для потокового вычисления GLDM.
+    ///
+    /// Отдаёт строки сверху вниз по одной, не загружая изображение целиком.
+    class RowSource
+    {
+    public:
+        virtual ~RowSource() = default;
+
+        /// \brief Высота изображения.
+        [[nodiscard]] virtual int rows() const = 0;
+
+        /// \brief Ширина изображения.
+        [[nodiscard]] virtual int cols() const = 0;
+
+        /// \brief Глубина пикселя, `CV_8U` или `CV_16U`.
+        [[nodiscard]] virtual int depth() const = 0;
+
+        /// \brief Читает следующую строку.
+        /// \param[out] row Буфер размера `cols() * CV_ELEM_SIZE1(depth())` байт, пиксели в порядке байт машины.
+        /// \return `true`, если строка прочитана, иначе `false`.
+        virtual bool readRow(uchar* row) = 0;
+    };
+
+    /// \brief Заголовок бинарного PGM (P5).
+    struct PgmHeader
+    {
+        int width = 0; ///< Ширина изображения.
+        int height = 0; ///< Высота изображения.
+        int maxValue = 0; ///< Наибольшее значение пикселя; больше 255 - два байта на пиксель.
+        size_t dataOffset = 0; ///< Смещение пикселей от начала файла.
+    };
+
+    /// \brief Разбирает заголовок PGM в начале буфера.
+    /// \param[in] data Содержимое файла.
+    /// \param[in] size Размер содержимого в байтах.
+    /// \param[out] header Заголовок.
+    /// \return `false`, если это не бинарный PGM или заголовок повреждён.
+    bool parsePgmHeader(const uchar* data, size_t size, PgmHeader& header);
+
+    /// \brief Построчное чтение бинарного PGM (P5) с глубиной 8 или 16 бит.
+    class PgmRowSource final : public RowSource
+    {
+    public:
+        /// \brief Открывает файл и разбирает заголовок.
+        /// \param[in] path Путь к файлу.
+        explicit PgmRowSource(const std::filesystem::path& path);
+
+        /// \brief Проверяет, что файл открыт и формат поддерживается.
+        [[nodiscard]] bool isOpen() const;
+
+        [[nodiscard]] int rows() const override { return height; }
+        [[nodiscard]] int cols() const override { return width; }
+        [[nodiscard]] int depth() const override { return wide ? CV_16U : CV_8U; }
+        bool readRow(uchar* row) override;
+
+    private:
+        std::vector<char> buffer; ///< Буфер потока, данные читаются полосами такого размера.
+        std::ifstream file; ///< Открытый файл.
+        int width = 0; ///< Ширина изображения.
+        int height = 0; ///< Высота изображения.
+        bool valid = false; ///< Заголовок разобран и формат поддерживается.
+        bool wide = false; ///< Пиксель занимает два байта (maxval больше 255).
+    };
+
+    /// \brief Открывает построчный источник для файла, если его формат поддерживает потоковое чтение.
+    /// \param[in] path Путь к изображению.
+    /// \return Источник строк или `nullptr`, если файл нужно декодировать целиком.
+    std::unique_ptr<RowSource> openRowSource(const std::filesystem::path& path);
+}
+
+#endif
@@ -0,0 +1,658 @@
+#include "server.hpp"
+#include "boundedqueue.hpp"
+#include "resultwriter.hpp"
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace misis;
+
+namespace
+{
+    /// \brief Значение поля запроса. Вложенные объекты и массивы в запросах не нужны и не поддерживаются.
+    struct JsonValue
+    {
+        bool isString = false; ///< Строка; иначе число, `true`, `false` или `null`.
+        std::string text; ///< Строка без кавычек и экранирования или исходная запись значения.
+    };
+
+    void skipSpace(std::string_view text, size_t& position)
+    {
+        while (position < text.size() && (text[position] == ' ' || text[position] == '\t' || text[position] == '\r' || text[position] == '\n'))
+            ++position;
+    }
+
+    void appendUtf8(std::string& out, uint32_t code)
+    {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        }
+        else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    bool readHex4(std::string_view text, size_t& position, uint32_t& code)
+    {
+        if (position + 4 > text.size())
+            return false;
+        const auto [end, error] = std::from_chars(text.data() + position, text.data() + position + 4, code, 16);
+        if (error != std::errc() || end != text.data() + position + 4)
+            return false;
+        position += 4;
+        return true;
+    }
+
+    /// \brief Читает строку JSON; `position` указывает на открывающую кавычку.
+    bool readString(std::string_view text, size_t& position, std::string& value)
+    {
+        if (position >= text.size() || text[position] != '"')
+            return false;
+        ++position;
+        value.clear();
+        while (position < text.size()) {
+            const char c = text[position++];
+            if (c == '"')
+                return true;
+            if (c != '\\') {
+                value += c;
+                continue;
+            }
+            if (position >= text.size())
+                return false;
+            const char escaped = text[position++];
+            switch (escaped) {
+            case '"': value += '"'; break;
+            case '\\': value += '\\'; break;
+            case '/': value += '/'; break;
+            case 'b': value += '\b'; break;
+            case 'f': value += '\f'; break;
+            case 'n': value += '\n'; break;
+            case 'r': value += '\r'; break;
+            case 't': value += '\t'; break;
+            case 'u': {
+                uint32_t code = 0;
+                if (!readHex4(text, position, code))
+                    return false;
+                // Characters outside the BMP arrive as a surrogate pair.
+                if (code >= 0xD800 && code < 0xDC00) {
+                    uint32_t low = 0;
+                    if (text.substr(position, 2) != "\\u")
+                        return false;
+                    position += 2;
+                    if (!readHex4(text, position, low) || low < 0xDC00 || low >= 0xE000)
+                        return false;
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                }
+                appendUtf8(value, code);
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+        return false;
+    }
+
+    /// \brief Проверяет запись числа по грамматике JSON: `from_chars` принимает и `nan`, и `inf`.
+    bool isJsonNumber(std::string_view text)
+    {
+        size_t position = 0;
+        const auto digits = [&] {
+            const size_t start = position;
+            while (position < text.size() && text[position] >= '0' && text[position] <= '9')
+                ++position;
+            return position > start;
+        };
+        if (position < text.size() && text[position] == '-')
+            ++position;
+        if (position < text.size() && text[position] == '0')
+            ++position;
+        else if (!digits())
+            return false;
+        if (position < text.size() && text[position] == '.') {
+            ++position;
+            if (!digits())
+                return false;
+        }
+        if (position < text.size() && (text[position] == 'e' || text[position] == 'E')) {
+            ++position;
+            if (position < text.size() && (text[position] == '+' || text[position] == '-'))
+                ++position;
+            if (!digits())
+                return false;
+        }
+        return position == text.size();
+    }
+
+    bool readValue(std::string_view text, size_t& position, JsonValue& value)
+    {
+        if (position < text.size() && text[position] == '"') {
+            value.isString = true;
+            return readString(text, position, value.text);
+        }
+        const size_t start = position;
+        while (position < text.size() && text[position] != ',' && text[position] != '}'
+            && text[position] != ' ' && text[position] != '\t' && text[position] != '\r' && text[position] != '\n')
+            ++position;
+        value.isString = false;
+        value.text = std::string(text.substr(start, position - start));
+        if (value.text == "true" || value.text == "false" || value.text == "null")
+            return true;
+        return isJsonNumber(value.text);
+    }
+
+    /// \brief Разбирает объект JSON с простыми значениями полей.
+    bool parseFlatObject(std::string_view text, std::map<std::string, JsonValue>& fields, std::string& error)
+    {
+        size_t position = 0;
+        skipSpace(text, position);
+        if (position >= text.size() || text[position++] != '{') {
+            error = "A request must be a JSON object";
+            return false;
+        }
+        skipSpace(text, position);
+        if (position < text.size() && text[position] == '}') {
+            ++position;
+        }
+        else {
+            for (;;) {
+                std::string key;
+                JsonValue value;
+                skipSpace(text, position);
+                if (!readString(text, position, key)) {
+                    error = "Malformed field name";
+                    return false;
+                }
+                skipSpace(text, position);
+                if (position >= text.size() || text[position++] != ':') {
+                    error = "Expected ':' after \"" + key + "\"";
+                    return false;
+                }
+                skipSpace(text, position);
+                if (!readValue(text, position, value)) {
+                    error = "Malformed value of \"" + key + "\"";
+                    return false;
+                }
+                fields[key] = std::move(value);
+                skipSpace(text, position);
+                if (position < text.size() && text[position] == ',') {
+                    ++position;
+                    continue;
+                }
+                if (position < text.size() && text[position] == '}') {
+                    ++position;
+                    break;
+                }
+                error = "Expected ',' or '}'";
+                return false;
+            }
+        }
+        skipSpace(text, position);
+        if (position != text.size()) {
+            error = "Unexpected data after the request object";
+            return false;
+        }
+        return true;
+    }
+
+    bool decodeBase64(std::string_view text, std::vector<uchar>& bytes)
+    {
+        static const auto table = [] {
+            std::array<int8_t, 256> values;
+            values.fill(-1);
+            const std::string_view alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            for (size_t k = 0; k < alphabet.size(); ++k)
+                values[static_cast<uchar>(alphabet[k])] = static_cast<int8_t>(k);
+            return values;
+        }();
+
+        while (!text.empty() && text.back() == '=')
+            text.remove_suffix(1);
+        bytes.clear();
+        bytes.reserve(text.size() * 3 / 4);
+        uint32_t accumulator = 0;
+        int bits = 0;
+        for (const char c : text) {
+            const int value = table[static_cast<uchar>(c)];
+            if (value < 0)
+                return false;
+            accumulator = (accumulator << 6) | static_cast<uint32_t>(value);
+            bits += 6;
+            if (bits >= 8) {
+                bits -= 8;
+                bytes.push_back(static_cast<uchar>(accumulator >> bits));
+            }
+        }
+        return true;
+    }
+
+    bool readNumber(const std::map<std::string, JsonValue>& fields, const std::string& key, Real& value, std::string& error)
+    {
+        const auto it = fields.find(key);
+        if (it == fields.end())
+            return true;
+        double number = 0;
+        const std::string& text = it->second.text;
+        const auto [end, parseError] = std::from_chars(text.data(), text.data() + text.size(), number);
+        if (it->second.isString || !isJsonNumber(text) || parseError != std::errc() || end != text.data() + text.size()
+            || !std::isfinite(number)) {
+            error = "\"" + key + "\" must be a number";
+            return false;
+        }
+        value = static_cast<Real>(number);
+        return true;
+    }
+
+    /// \brief Получатель ответов одного клиента.
+    class ResponseChannel
+    {
+    public:
+        virtual ~ResponseChannel() = default;
+
+        /// \brief Отправляет строку ответа целиком; вызывается из разных потоков.
+        virtual void send(const std::string& line) = 0;
+    };
+
+    class StreamChannel final : public ResponseChannel
+    {
+    public:
+        explicit StreamChannel(std::ostream& out)
+            : out(out)
+        {
+        }
+
+        void send(const std::string& line) override
+        {
+            std::lock_guard lock(mutex);
+            out.write(line.data(), static_cast<std::streamsize>(line.size()));
+            // The client waits for this answer, so it cannot sit in the buffer.
+            out.flush();
+        }
+
+    private:
+        std::ostream& out;
+        std::mutex mutex;
+    };
+
+#ifndef _WIN32
+    /// \brief Соединение с клиентом сокета; закрывается, когда отправлены ответы на все его запросы.
+    class SocketChannel final : public ResponseChannel
+    {
+    public:
+        explicit SocketChannel(int fd)
+            : fd(fd)
+        {
+        }
+
+        ~SocketChannel() override
+        {
+            ::close(fd);
+        }
+
+        void send(const std::string& line) override
+        {
+            std::lock_guard lock(mutex);
+            size_t sent = 0;
+            while (sent < line.size()) {
+#ifdef MSG_NOSIGNAL
+                const ssize_t written = ::send(fd, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+#else
+                const ssize_t written = ::send(fd, line.data() + sent, line.size() - sent, 0);
+#endif
+                if (written < 0 && errno == EINTR)
+                    continue;
+                // A client that went away does not get its answers; the server keeps running.
+                if (written <= 0)
+                    return;
+                sent += static_cast<size_t>(written);
+            }
+        }
+
+    private:
+        int fd;
+        std::mutex mutex;
+    };
+#endif
+
+    /// \brief Запрос в очереди пула вместе с получателем ответа.
+    struct Job
+    {
+        std::string line;
+        std::shared_ptr<ResponseChannel> channel;
+    };
+
+    /// \brief Пул потоков, выполняющих запросы из общей очереди.
+    class WorkerPool
+    {
+    public:
+        WorkerPool(const GLDMExtractor& extractor, int workers, Real alpha, Real delta)
+            : queue(4 * static_cast<size_t>(std::max(1, workers)), 1)
+            , alpha(alpha)
+            , delta(delta)
+        {
+            for (int w = 0; w < std::max(1, workers); ++w)
+                threads.emplace_back([this, &extractor] { run(extractor); });
+        }
+
+        /// \brief Дожидается ответов на все принятые запросы.
+        ~WorkerPool()
+        {
+            queue.producerDone();
+            for (std::thread& thread : threads)
+                thread.join();
+        }
+
+        void submit(Job job)
+        {
+            queue.push(std::move(job));
+        }
+
+    private:
+        void run(const GLDMExtractor& extractor)
+        {
+            // Each worker keeps its own extractor, request, decode and matrix buffers and response for its
+            // whole lifetime, so a stream of same-sized images does not allocate per request.
+            GLDMExtractor local = extractor;
+            local.setKeepImages(false);
+            local.setFeatureMapWindow(0);
+            Real currentAlpha = alpha;
+            Real currentDelta = delta;
+            local.setParams(currentAlpha, currentDelta);
+            ServerRequest request;
+            LoadedImage buffers;
+            std::string response;
+
+            Job job;
+            while (queue.pop(job)) {
+                std::string error;
+                response.clear();
+                try
+                {
+                    const int grayLevels = local.getQuantization().grayLevels;
+                    if (parseServerRequest(job.line, alpha, delta, request, error)
+                        && !GLDM::isValidDelta(request.delta, grayLevels))
+                        error = "\"delta\" must be in 0.." + std::to_string(GLDM::maxDeltaFor(grayLevels));
+                    else if (error.empty()) {
+                        if (request.alpha != currentAlpha || request.delta != currentDelta) {
+                            currentAlpha = request.alpha;
+                            currentDelta = request.delta;
+                            local.setParams(currentAlpha, currentDelta);
+                        }
+                        AnalysisResult result;
+                        if (request.hasBytes)
+                            result = local.analyzeEncoded(request.name, request.bytes, buffers);
+                        else {
+                            local.load(request.path, buffers);
+                            result = local.analyzeLoaded(request.path, buffers);
+                        }
+                        if (result.category != "Invalid")
+                            appendJsonResult(response, result, request.id.empty() ? std::string() : "\"id\":" + request.id + ",");
+                        else
+                            error = "Failed to read or analyze the image";
+                    }
+                }
+                catch (const std::exception& e)
+                {
+                    error = e.what();
+                    buffers = LoadedImage{};
+                }
+
+                if (!error.empty()) {
+                    response = "{\"id\":";
+                    response += request.id.empty() ? "null" : request.id;
+                    response += ",\"error\":";
+                    appendJsonString(response, error);
+                    response += '}';
+                }
+                response += '\n';
+                job.channel->send(response);
+                job = Job{};
+            }
+        }
+
+        BoundedQueue<Job> queue;
+        Real alpha;
+        Real delta;
+        std::vector<std::thread> threads;
+    };
+
+    /// \brief Отправляет ответ на запрос, который не удалось даже прочитать.
+    void sendError(ResponseChannel& channel, const std::string& error)
+    {
+        std::string response = "{\"id\":null,\"error\":";
+        appendJsonString(response, error);
+        response += "}\n";
+        channel.send(response);
+    }
+
+    std::string lineTooLongError()
+    {
+        return "A request line must not exceed " + std::to_string(GLDMServer::maxRequestBytes) + " bytes";
+    }
+
+    enum class LineStatus
+    {
+        Line, ///< Прочитана строка.
+        TooLong, ///< Строка длиннее `GLDMServer::maxRequestBytes` пропущена.
+        End, ///< Поток закончился.
+    };
+
+    /// \brief Читает строку, не держа в памяти больше `GLDMServer::maxRequestBytes`.
+    LineStatus readRequestLine(std::istream& in, std::string& line)
+    {
+        using Traits = std::char_traits<char>;
+        line.clear();
+        std::streambuf* buffer = in.rdbuf();
+        bool tooLong = false;
+        bool any = false;
+        for (Traits::int_type c = buffer->sbumpc(); !Traits::eq_int_type(c, Traits::eof()); c = buffer->sbumpc()) {
+            any = true;
+            if (c == '\n')
+                break;
+            if (tooLong)
+                continue;
+            if (line.size() < GLDMServer::maxRequestBytes) {
+                line += Traits::to_char_type(c);
+                continue;
+            }
+            tooLong = true;
+            line.clear();
+            line.shrink_to_fit();
+        }
+        if (!any)
+            return LineStatus::End;
+        return tooLong ? LineStatus::TooLong : LineStatus::Line;
+    }
+
+    /// \brief Отправляет в пул запросы из строки, пропуская пустые.
+    void submitLine(WorkerPool& pool, std::string line, const std::shared_ptr<ResponseChannel>& channel)
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.find_first_not_of(" \t") == std::string::npos)
+            return;
+        pool.submit({ std::move(line), channel });
+    }
+}
+
+bool misis::parseServerRequest(const std::string& line, Real alpha, Real delta, ServerRequest& request, std::string& error)
+{
+    // A reused request must not answer with the id of the previous one.
+    request.id.clear();
+    std::map<std::string, JsonValue> fields;
+    if (!parseFlatObject(line, fields, error))
+        return false;
+
+    if (const auto it = fields.find("id"); it != fields.end()) {
+        if (it->second.isString)
+            appendJsonString(request.id, it->second.text);
+        else
+            request.id = it->second.text;
+    }
+
+    const auto path = fields.find("path");
+    const auto bytes = fields.find("bytes");
+    if ((path == fields.end()) == (bytes == fields.end())) {
+        error = "Exactly one of \"path\" and \"bytes\" is required";
+        return false;
+    }
+    if (path != fields.end()) {
+        if (!path->second.isString) {
+            error = "\"path\" must be a string";
+            return false;
+        }
+        request.path = path->second.text;
+        request.hasBytes = false;
+    }
+    else {
+        if (!bytes->second.isString || !decodeBase64(bytes->second.text, request.bytes)) {
+            error = "\"bytes\" must be a base64 string";
+            return false;
+        }
+        request.hasBytes = true;
+        const auto name = fields.find("name");
+        request.name = name != fields.end() && name->second.isString ? name->second.text : "<bytes>";
+    }
+
+    request.alpha = alpha;
+    request.delta = delta;
+    return readNumber(fields, "alpha", request.alpha, error) && readNumber(fields, "delta", request.delta, error);
+}
+
+GLDMServer::GLDMServer(const GLDMExtractor& extractor, int workers, Real alpha, Real delta)
+    : extractor(extractor)
+    , workers(workers)
+    , alpha(alpha)
+    , delta(delta)
+{
+}
+
+void GLDMServer::serveStream(std::istream& in, std::ostream& out) const
+{
+    const auto channel = std::make_shared<StreamChannel>(out);
+    WorkerPool pool(extractor, workers, alpha, delta);
+    std::string line;
+    for (LineStatus status = readRequestLine(in, line); status != LineStatus::End; status = readRequestLine(in, line)) {
+        if (status == LineStatus::TooLong)
+            sendError(*channel, lineTooLongError());
+        else
+            submitLine(pool, std::move(line), channel);
+    }
+}
+
+bool GLDMServer::serveSocket(const std::filesystem::path& socketPath) const
+{
+#ifdef _WIN32
+    std::cerr << "Unix sockets are not supported on this platform" << std::endl;
+    return false;
+#else
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    const std::string pathText = socketPath.string();
+    CheckReturn(!pathText.empty() && pathText.size() < sizeof(address.sun_path), false);
+    std::memcpy(address.sun_path, pathText.c_str(), pathText.size() + 1);
+
+    // Only a socket left by an earlier run is replaced; any other file at the path is kept.
+    struct stat existing{};
+    if (::lstat(pathText.c_str(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) {
+            std::cerr << "Could not listen on " << pathText << ": the path exists and is not a socket" << std::endl;
+            return false;
+        }
+        ::unlink(pathText.c_str());
+    }
+
+    const int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    CheckReturn(listener >= 0, false);
+    if (::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || ::listen(listener, 16) != 0) {
+        std::cerr << "Could not listen on " << pathText << ": " << std::strerror(errno) << std::endl;
+        ::close(listener);
+        return false;
+    }
+    std::cerr << "Listening on " << pathText << std::endl;
+
+    // Connection threads are detached, so they share ownership of the pool and the connection count.
+    const auto pool = std::make_shared<WorkerPool>(extractor, workers, alpha, delta);
+    const auto connections = std::make_shared<std::atomic<int>>(0);
+    for (;;) {
+        const int client = ::accept(listener, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            std::cerr << "Could not accept a connection: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        if (connections->fetch_add(1) >= maxConnections) {
+            connections->fetch_sub(1);
+            SocketChannel refused(client);
+            sendError(refused, "Too many connections, at most " + std::to_string(maxConnections) + " are served at once");
+            continue;
+        }
+
+        std::thread([pool, connections, client] {
+            const auto channel = std::make_shared<SocketChannel>(client);
+            std::string pending;
+            bool tooLong = false;
+            std::vector<char> buffer(1 << 16);
+            for (;;) {
+                const ssize_t received = ::recv(client, buffer.data(), buffer.size(), 0);
+                if (received < 0 && errno == EINTR)
+                    continue;
+                if (received <= 0)
+                    break;
+                pending.append(buffer.data(), static_cast<size_t>(received));
+                // The leftover before this chunk has no newline, so only the new bytes are searched.
+                size_t start = 0;
+                for (size_t end = pending.find('\n', pending.size() - static_cast<size_t>(received)); end != std::string::npos;
+                     end = pending.find('\n', start)) {
+                    submitLine(*pool, pending.substr(start, end - start), channel);
+                    start = end + 1;
+                }
+                pending.erase(0, start);
+                // A line that never ends would otherwise grow without bound.
+                if (pending.size() > maxRequestBytes) {
+                    tooLong = true;
+                    break;
+                }
+            }
+            if (tooLong)
+                sendError(*channel, lineTooLongError());
+            else
+                submitLine(*pool, std::move(pending), channel);
+            connections->fetch_sub(1);
+            // The channel, and with it the descriptor, is closed once the last pending answer has been sent.
+        }).detach();
+    }
+
+    ::close(listener);
+    ::unlink(pathText.c_str());
+    return false;
+#endif
+}
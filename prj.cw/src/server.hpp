@@ -0,0 +1,84 @@
+#pragma once
+
+#ifndef GLDMServer_2025
+#define GLDMServer_2025
+
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "extractor.hpp"
+
+namespace misis
+{
+    /// \brief Запрос к серверу анализа.
+    struct ServerRequest
+    {
+        std::string id; ///< Поле `id` запроса в виде JSON, пустое, если его нет.
+        std::string path; ///< Путь к изображению.
+        std::vector<uchar> bytes; ///< Содержимое файла изображения из поля `bytes` (base64).
+        bool hasBytes = false; ///< Изображение передано содержимым, а не путём.
+        std::string name; ///< Имя изображения для результата, если передано содержимое.
+        Real alpha = 0; ///< Порог alpha.
+        Real delta = 0; ///< Радиус delta.
+    };
+
+    /// \brief Разбирает строку запроса JSON Lines.
+    ///
+    /// Запрос - объект `{"id": ..., "path": "...", "alpha": 5, "delta": 1}`, где вместо `path`
+    /// можно передать `bytes` - файл изображения в base64 - и необязательное `name`.
+    /// `id` возвращается в ответе как есть; `alpha` и `delta` необязательны.
+    /// \param[in] line Строка запроса.
+    /// \param[in] alpha alpha по умолчанию.
+    /// \param[in] delta delta по умолчанию.
+    /// \param[out] request Запрос.
+    /// \param[out] error Описание ошибки.
+    /// \return `false`, если запрос некорректен.
+    bool parseServerRequest(const std::string& line, Real alpha, Real delta, ServerRequest& request, std::string& error);
+
+    /// \brief Постоянно работающий сервер анализа: запросы JSON Lines через stdin или Unix-сокет.
+    ///
+    /// Запросы выполняет пул потоков, каждый со своей копией анализатора, поэтому запуск процесса,
+    /// инициализация OpenCV и кэш матриц остаются общими для всех запросов. На каждый запрос
+    /// отправляется одна строка: результат в виде записи `--format jsonl` с полем `id` или
+    /// `{"id": ..., "error": "..."}`. Ответы приходят по мере готовности и могут идти не в порядке
+    /// запросов; сопоставлять их следует по `id`.
+    class GLDMServer final
+    {
+    public:
+        /// \brief Наибольшая длина строки запроса; на более длинную строку отправляется ошибка.
+        static constexpr size_t maxRequestBytes = size_t(64) << 20;
+
+        /// \brief Наибольшее число одновременно обслуживаемых соединений сокета; лишние получают ошибку и закрываются.
+        static constexpr int maxConnections = 64;
+
+        /// \param[in] extractor Настроенный анализатор; его alpha и delta используются по умолчанию.
+        /// \param[in] workers Число потоков, выполняющих запросы.
+        /// \param[in] alpha alpha по умолчанию.
+        /// \param[in] delta delta по умолчанию.
+        GLDMServer(const GLDMExtractor& extractor, int workers, Real alpha, Real delta);
+
+        /// \brief Читает запросы из потока до его конца и пишет ответы в `out`.
+        ///
+        /// Строка длиннее `maxRequestBytes` пропускается с ответом-ошибкой.
+        /// \param[in] in Поток запросов.
+        /// \param[out] out Поток ответов.
+        void serveStream(std::istream& in, std::ostream& out) const;
+
+        /// \brief Принимает соединения на Unix-сокете; каждое соединение - свой поток запросов и ответов.
+        ///
+        /// Работает, пока процесс не будет остановлен. Не поддерживается в Windows. Если клиент
+        /// присылает строку длиннее `maxRequestBytes`, он получает ошибку, и соединение закрывается.
+        /// \param[in] socketPath Путь к сокету; сокет, оставшийся от прошлого запуска, удаляется.
+        /// \return `false`, если сокет не удалось открыть или по пути лежит файл, который не является сокетом.
+        bool serveSocket(const std::filesystem::path& socketPath) const;
+
+    private:
+        const GLDMExtractor& extractor; ///< Настроенный анализатор.
+        int workers; ///< Размер пула.
+        Real alpha; ///< alpha по умолчанию.
+        Real delta; ///< delta по умолчанию.
+    };
+}
+
+#endif
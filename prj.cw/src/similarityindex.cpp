@@ -0,0 +1,334 @@
+#include "similarityindex.hpp"
+#include "profiler.hpp"
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+using namespace misis;
+
+namespace
+{
+    constexpr char indexMagic[8] = { 'G', 'L', 'D', 'M', 'I', 'D', 'X', '2' };
+    constexpr int featureCount = static_cast<int>(GLDMFeatureSet::size);
+    /// \brief Число float в векторе индекса: признаки, дополненные нулями до целого числа векторных регистров.
+    constexpr int vectorStride = 16;
+    static_assert(featureCount <= vectorStride && vectorStride % 4 == 0);
+    /// \brief Размер корпуса, начиная с которого списки создаются без явного указания.
+    constexpr size_t autoListThreshold = 10000;
+    /// \brief Число векторов в одной порции работы потока.
+    constexpr uint64_t searchChunk = 16384;
+
+    /// \brief Заголовок файла индекса.
+    struct IndexHeader
+    {
+        char magic[8];
+        uint32_t dimensions; ///< Число признаков, `GLDMFeatureSet::size`.
+        uint32_t stride; ///< Число float в векторе, `vectorStride`.
+        uint64_t count; ///< Число изображений.
+        uint32_t lists; ///< Число списков.
+        float alpha;
+        float delta;
+        int32_t grayLevels;
+        int32_t quantizationMode;
+        int32_t binWidth;
+        int32_t decodeReduction; ///< Уменьшение сторон при декодировании (`--fast-decode`), 1 - без уменьшения.
+        uint32_t reserved; ///< Выравнивание, всегда 0.
+        float mean[vectorStride]; ///< Средние логарифмированных признаков.
+        float scale[vectorStride]; ///< Обратные стандартные отклонения.
+    };
+    static_assert(std::is_trivially_copyable_v<IndexHeader> && sizeof(IndexHeader) == 184);
+
+    /// \brief Логарифм со знаком: сближает признаки, отличающиеся на порядки.
+    inline float compress(double value)
+    {
+        if (!std::isfinite(value))
+            return 0.0f;
+        return static_cast<float>(std::copysign(std::log1p(std::abs(value)), value));
+    }
+
+    /// \brief Стандартизует логарифмированные признаки и дополняет вектор нулями.
+    void normalize(const float* logValues, const float* mean, const float* scale, float* out)
+    {
+        for (int i = 0; i < vectorStride; ++i)
+            out[i] = i < featureCount ? (logValues[i] - mean[i]) * scale[i] : 0.0f;
+    }
+
+    /// \brief Квадрат евклидова расстояния между векторами индекса.
+    inline float squaredDistance(const float* a, const float* b)
+    {
+#if CV_SIMD128
+        cv::v_float32x4 sum = cv::v_setzero_f32();
+        for (int i = 0; i < vectorStride; i += 4) {
+            const cv::v_float32x4 diff = cv::v_load(a + i) - cv::v_load(b + i);
+            sum = cv::v_muladd(diff, diff, sum);
+        }
+        return cv::v_reduce_sum(sum);
+#else
+        float sum = 0.0f;
+        for (int i = 0; i < vectorStride; ++i)
+            sum += (a[i] - b[i]) * (a[i] - b[i]);
+        return sum;
+#endif
+    }
+
+    /// \brief Кандидат поиска: квадрат расстояния и номер вектора.
+    using Candidate = std::pair<float, uint64_t>;
+
+    /// \brief Держит в куче `k` ближайших кандидатов, на вершине - самый дальний из них.
+    inline void offer(std::vector<Candidate>& heap, size_t k, float distance, uint64_t index)
+    {
+        if (heap.size() < k) {
+            heap.emplace_back(distance, index);
+            std::push_heap(heap.begin(), heap.end());
+        }
+        else if (distance < heap.front().first) {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.back() = { distance, index };
+            std::push_heap(heap.begin(), heap.end());
+        }
+    }
+
+    template <typename T>
+    void writeArray(std::ofstream& file, const T* data, size_t count)
+    {
+        file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(count * sizeof(T)));
+    }
+
+    /// \brief Проверяет, что границы разделов не убывают и заканчиваются на `last`.
+    bool isMonotonic(const uint64_t* offsets, size_t count, uint64_t last)
+    {
+        if (offsets[0] != 0 || offsets[count] != last)
+            return false;
+        for (size_t i = 0; i < count; ++i)
+            if (offsets[i] > offsets[i + 1])
+                return false;
+        return true;
+    }
+}
+
+SimilarityIndexBuilder::SimilarityIndexBuilder(Real alpha, Real delta, const GLDMQuantization& quantization, int decodeReduction)
+    : alpha(alpha)
+    , delta(delta)
+    , quantization(quantization)
+    , decodeReduction(decodeReduction)
+{
+}
+
+void SimilarityIndexBuilder::add(const AnalysisResult& result)
+{
+    if (result.category == "Invalid")
+        return;
+    for (const double value : result.features.values())
+        values.push_back(compress(value));
+    names.push_back(result.imageName);
+}
+
+bool SimilarityIndexBuilder::save(const std::filesystem::path& path, int lists) const
+{
+    CheckReturn(!names.empty() && lists >= 0, false);
+    GLDM_PROFILE_SCOPE("SimilarityIndexBuilder::save");
+    const size_t count = names.size();
+
+    IndexHeader header{};
+    std::memcpy(header.magic, indexMagic, sizeof(indexMagic));
+    header.dimensions = featureCount;
+    header.stride = vectorStride;
+    header.count = count;
+    header.alpha = alpha;
+    header.delta = delta;
+    header.grayLevels = quantization.grayLevels;
+    header.quantizationMode = static_cast<int32_t>(quantization.mode);
+    header.binWidth = quantization.binWidth;
+    header.decodeReduction = decodeReduction;
+
+    // Standardizing gives every feature the same weight in the distance; constant features get no weight.
+    for (int d = 0; d < featureCount; ++d) {
+        double sum = 0.0;
+        double squares = 0.0;
+        for (size_t i = 0; i < count; ++i) {
+            const double value = values[i * featureCount + d];
+            sum += value;
+            squares += value * value;
+        }
+        const double mean = sum / count;
+        const double deviation = std::sqrt(std::max(squares / count - mean * mean, 0.0));
+        header.mean[d] = static_cast<float>(mean);
+        header.scale[d] = deviation > 1e-6 ? static_cast<float>(1.0 / deviation) : 0.0f;
+    }
+
+    cv::Mat normalized(static_cast<int>(count), vectorStride, CV_32F);
+    for (size_t i = 0; i < count; ++i)
+        normalize(values.data() + i * featureCount, header.mean, header.scale, normalized.ptr<float>(static_cast<int>(i)));
+
+    if (lists == 0)
+        lists = count >= autoListThreshold ? cvRound(std::sqrt(static_cast<double>(count))) : 1;
+    lists = static_cast<int>(std::min<size_t>(lists, count));
+    header.lists = static_cast<uint32_t>(lists);
+
+    cv::Mat centers = cv::Mat::zeros(lists, vectorStride, CV_32F);
+    std::vector<int> assignment(count, 0);
+    if (lists > 1) {
+        // k-means is trained on an evenly spaced sample; assigning every vector afterwards is one cheap pass.
+        const size_t sampleCount = std::min(count, std::max<size_t>(static_cast<size_t>(lists) * 64, 65536));
+        cv::Mat sample(static_cast<int>(sampleCount), vectorStride, CV_32F);
+        for (size_t s = 0; s < sampleCount; ++s)
+            normalized.row(static_cast<int>(s * count / sampleCount)).copyTo(sample.row(static_cast<int>(s)));
+
+        // A fixed seed makes the same corpus always produce the same index.
+        cv::setRNGSeed(2025);
+        cv::Mat labels;
+        cv::kmeans(sample, lists, labels, cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 20, 1e-4),
+            1, cv::KMEANS_PP_CENTERS, centers);
+
+        const int chunks = static_cast<int>((count + searchChunk - 1) / searchChunk);
+        cv::parallel_for_(cv::Range(0, chunks), [&](const cv::Range& range) {
+            for (size_t i = range.start * searchChunk; i < std::min<size_t>(range.end * searchChunk, count); ++i) {
+                const float* vector = normalized.ptr<float>(static_cast<int>(i));
+                float best = std::numeric_limits<float>::max();
+                for (int list = 0; list < lists; ++list) {
+                    const float distance = squaredDistance(vector, centers.ptr<float>(list));
+                    if (distance < best) {
+                        best = distance;
+                        assignment[i] = list;
+                    }
+                }
+            }
+        });
+    }
+
+    // Vectors of one list are stored together, so a probe scans one contiguous range.
+    std::vector<uint64_t> listOffsets(lists + 1, 0);
+    for (const int list : assignment)
+        listOffsets[list + 1]++;
+    for (int list = 0; list < lists; ++list)
+        listOffsets[list + 1] += listOffsets[list];
+    std::vector<uint64_t> order(count);
+    std::vector<uint64_t> next(listOffsets.begin(), listOffsets.end() - 1);
+    for (size_t i = 0; i < count; ++i)
+        order[next[assignment[i]]++] = i;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    CheckReturn(file.is_open(), false);
+    writeArray(file, &header, 1);
+    for (int list = 0; list < lists; ++list)
+        writeArray(file, centers.ptr<float>(list), vectorStride);
+    writeArray(file, listOffsets.data(), listOffsets.size());
+    for (const uint64_t i : order)
+        writeArray(file, normalized.ptr<float>(static_cast<int>(i)), vectorStride);
+
+    uint64_t nameOffset = 0;
+    writeArray(file, &nameOffset, 1);
+    for (const uint64_t i : order) {
+        nameOffset += names[i].size();
+        writeArray(file, &nameOffset, 1);
+    }
+    for (const uint64_t i : order)
+        file.write(names[i].data(), static_cast<std::streamsize>(names[i].size()));
+    return static_cast<bool>(file);
+}
+
+bool SimilarityIndex::open(const std::filesystem::path& path)
+{
+    count = 0;
+    file = MappedFile(path);
+    CheckReturn(file.isOpen() && file.size() >= sizeof(IndexHeader), false);
+
+    IndexHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    constexpr size_t vectorBytes = vectorStride * sizeof(float);
+    CheckReturn(std::memcmp(header.magic, indexMagic, sizeof(indexMagic)) == 0
+        && header.dimensions == featureCount && header.stride == vectorStride, false);
+    // Section sizes are checked against the file length before any pointer into the mapping is formed.
+    CheckReturn(header.count > 0 && header.count < file.size() / vectorBytes
+        && header.lists >= 1 && header.lists <= header.count, false);
+
+    const size_t centroidStart = sizeof(IndexHeader);
+    const size_t listStart = centroidStart + header.lists * vectorBytes;
+    const size_t vectorStart = listStart + (header.lists + 1) * sizeof(uint64_t);
+    const size_t nameOffsetStart = vectorStart + header.count * vectorBytes;
+    const size_t nameStart = nameOffsetStart + (header.count + 1) * sizeof(uint64_t);
+    CheckReturn(nameStart <= file.size(), false);
+
+    const uint8_t* data = file.data();
+    centroids = reinterpret_cast<const float*>(data + centroidStart);
+    listOffsets = reinterpret_cast<const uint64_t*>(data + listStart);
+    vectors = reinterpret_cast<const float*>(data + vectorStart);
+    nameOffsets = reinterpret_cast<const uint64_t*>(data + nameOffsetStart);
+    nameData = reinterpret_cast<const char*>(data + nameStart);
+    CheckReturn(isMonotonic(listOffsets, header.lists, header.count)
+        && isMonotonic(nameOffsets, header.count, file.size() - nameStart), false);
+
+    GLDMQuantization levels;
+    levels.grayLevels = header.grayLevels;
+    levels.mode = static_cast<QuantizationMode>(header.quantizationMode);
+    levels.binWidth = header.binWidth;
+    CheckReturn(GLDM::isValidQuantization(levels), false);
+    CheckReturn(header.decodeReduction == 1 || header.decodeReduction == 2 || header.decodeReduction == 4
+        || header.decodeReduction == 8, false);
+
+    quantization = levels;
+    decodeReduction = header.decodeReduction;
+    alpha = header.alpha;
+    delta = header.delta;
+    std::copy(std::begin(header.mean), std::end(header.mean), mean.begin());
+    std::copy(std::begin(header.scale), std::end(header.scale), scale.begin());
+    lists = static_cast<int>(header.lists);
+    count = header.count;
+    return true;
+}
+
+std::vector<SimilarityMatch> SimilarityIndex::search(const GLDMFeatureSet& features, size_t k, int probes, int threads) const
+{
+    CheckReturn(count > 0 && k > 0, {});
+    GLDM_PROFILE_SCOPE("SimilarityIndex::search");
+
+    float logValues[vectorStride] = {};
+    const auto featureValues = features.values();
+    for (int d = 0; d < featureCount; ++d)
+        logValues[d] = compress(featureValues[d]);
+    float query[vectorStride];
+    normalize(logValues, mean.data(), scale.data(), query);
+
+    // Lists whose centres are nearest to the query; with a single list this is the whole corpus.
+    std::vector<Candidate> nearestLists;
+    for (int list = 0; list < lists; ++list)
+        nearestLists.emplace_back(squaredDistance(query, centroids + static_cast<size_t>(list) * vectorStride), list);
+    const size_t probeCount = std::clamp<size_t>(probes, 1, nearestLists.size());
+    std::partial_sort(nearestLists.begin(), nearestLists.begin() + probeCount, nearestLists.end());
+
+    std::vector<std::pair<uint64_t, uint64_t>> chunks;
+    for (size_t p = 0; p < probeCount; ++p) {
+        const uint64_t list = nearestLists[p].second;
+        for (uint64_t begin = listOffsets[list]; begin < listOffsets[list + 1]; begin += searchChunk)
+            chunks.emplace_back(begin, std::min(begin + searchChunk, listOffsets[list + 1]));
+    }
+
+    // Every chunk keeps its own k best, so workers never share a heap.
+    std::vector<std::vector<Candidate>> partial(chunks.size());
+    const int workers = threads <= 0 ? cv::getNumberOfCPUs() : threads;
+    cv::parallel_for_(cv::Range(0, static_cast<int>(chunks.size())), [&](const cv::Range& range) {
+        for (int c = range.start; c < range.end; ++c) {
+            std::vector<Candidate>& heap = partial[c];
+            heap.reserve(k);
+            for (uint64_t i = chunks[c].first; i < chunks[c].second; ++i)
+                offer(heap, k, squaredDistance(query, vectors + i * vectorStride), i);
+        }
+    }, std::min<double>(workers, static_cast<double>(chunks.size())));
+
+    std::vector<Candidate> best;
+    for (const std::vector<Candidate>& heap : partial)
+        for (const Candidate& candidate : heap)
+            offer(best, k, candidate.first, candidate.second);
+    std::sort(best.begin(), best.end());
+
+    std::vector<SimilarityMatch> matches;
+    matches.reserve(best.size());
+    for (const auto& [distance, i] : best)
+        matches.push_back({ std::string_view(nameData + nameOffsets[i], nameOffsets[i + 1] - nameOffsets[i]), std::sqrt(distance) });
+    return matches;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#ifndef GLDMSimilarityIndex_2025
+#define GLDMSimilarityIndex_2025
+
+#include "extractor.hpp"
+#include "mappedfile.hpp"
+#include <array>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace misis
+{
+    /// \brief Изображение корпуса, найденное `SimilarityIndex::search`.
+    struct SimilarityMatch
+    {
+        std::string_view imageName; ///< Имя изображения; указывает в отображение файла индекса.
+        float distance = 0.0f; ///< Евклидово расстояние между нормированными векторами признаков.
+    };
+
+    /// \brief Собирает векторы признаков корпуса и сохраняет индекс поиска похожих текстур.
+    ///
+    /// Признаки берутся из результатов пакетного анализа, поэтому индекс не требует отдельного прохода
+    /// по изображениям. При сохранении каждый признак логарифмируется (`log1p`, ненормированные
+    /// GLN и DN отличаются от остальных на порядки) и стандартизуется по корпусу.
+    class SimilarityIndexBuilder final
+    {
+    public:
+        /// \param[in] alpha Порог, с которым анализируется корпус.
+        /// \param[in] delta Радиус, с которым анализируется корпус.
+        /// \param[in] quantization Квантование, с которым анализируется корпус.
+        /// \param[in] decodeReduction Уменьшение сторон при декодировании корпуса (`setDecodeReduction`).
+        SimilarityIndexBuilder(Real alpha, Real delta, const GLDMQuantization& quantization, int decodeReduction = 1);
+
+        /// \brief Добавляет результат анализа; изображения, которые не удалось прочитать, пропускаются.
+        void add(const AnalysisResult& result);
+
+        /// \brief Число добавленных изображений.
+        [[nodiscard]] size_t size() const { return names.size(); }
+
+        /// \brief Сохраняет индекс.
+        ///
+        /// Формат файла: заголовок с сигнатурой `GLDMIDX2`, параметрами анализа (включая уменьшение при декодировании), средними и масштабами
+        /// признаков; центры списков; границы списков (uint64); векторы по 16 float, сгруппированные
+        /// по спискам; смещения имён (uint64) и сами имена.
+        /// \param[in] path Путь к файлу индекса.
+        /// \param[in] lists Число списков грубого квантователя (IVF): 1 - только полный перебор,
+        /// 0 - выбрать по размеру корпуса (`sqrt(N)` начиная с 10000 изображений).
+        /// \return `false`, если индекс пуст или файл не удалось записать.
+        bool save(const std::filesystem::path& path, int lists = 0) const;
+
+    private:
+        Real alpha; ///< Порог анализа корпуса.
+        Real delta; ///< Радиус анализа корпуса.
+        GLDMQuantization quantization; ///< Квантование анализа корпуса.
+        int decodeReduction; ///< Уменьшение сторон при декодировании корпуса.
+        std::vector<float> values; ///< Логарифмированные признаки, по `GLDMFeatureSet::size` на изображение.
+        std::vector<std::string> names; ///< Имена изображений.
+    };
+
+    /// \brief Индекс поиска похожих текстур, отображённый в память.
+    ///
+    /// Файл не читается целиком: векторы и имена берутся прямо из отображения, поэтому открытие
+    /// индекса на миллионы изображений не зависит от его размера. Расстояния считаются векторно
+    /// (универсальные интринсики OpenCV) в нескольких потоках. Если при сборке заданы списки,
+    /// просматриваются только `probes` списков, центры которых ближе всего к запросу.
+    class SimilarityIndex final
+    {
+    public:
+        /// \brief Отображает файл индекса в память и проверяет его структуру.
+        /// \param[in] path Путь к файлу, созданному `SimilarityIndexBuilder::save`.
+        /// \return `false`, если файл не найден или повреждён.
+        bool open(const std::filesystem::path& path);
+
+        /// \brief Число изображений в индексе.
+        [[nodiscard]] size_t size() const { return count; }
+
+        /// \brief Число списков грубого квантователя.
+        [[nodiscard]] int listCount() const { return lists; }
+
+        /// \brief Порог, с которым анализировался корпус; запросы нужно анализировать с ним же.
+        [[nodiscard]] Real getAlpha() const { return alpha; }
+
+        /// \brief Радиус, с которым анализировался корпус.
+        [[nodiscard]] Real getDelta() const { return delta; }
+
+        /// \brief Квантование, с которым анализировался корпус.
+        [[nodiscard]] const GLDMQuantization& getQuantization() const { return quantization; }
+
+        /// \brief Уменьшение сторон, с которым декодировался корпус; запрос декодируется так же.
+        [[nodiscard]] int getDecodeReduction() const { return decodeReduction; }
+
+        /// \brief Находит `k` изображений с самыми близкими признаками.
+        /// \param[in] features Признаки запроса, полученные с параметрами индекса.
+        /// \param[in] k Число результатов.
+        /// \param[in] probes Сколько ближайших списков просматривать; не больше `listCount`.
+        /// \param[in] threads Число потоков (0 - все ядра).
+        /// \return Результаты по возрастанию расстояния; действительны, пока открыт индекс.
+        [[nodiscard]] std::vector<SimilarityMatch> search(const GLDMFeatureSet& features, size_t k, int probes = 8, int threads = 0) const;
+
+    private:
+        MappedFile file; ///< Отображение файла индекса.
+        size_t count = 0; ///< Число изображений.
+        int lists = 0; ///< Число списков.
+        Real alpha = 0; ///< Порог анализа корпуса.
+        Real delta = 0; ///< Радиус анализа корпуса.
+        GLDMQuantization quantization; ///< Квантование анализа корпуса.
+        int decodeReduction = 1; ///< Уменьшение сторон при декодировании корпуса.
+        std::array<float, 16> mean{}; ///< Средние логарифмированных признаков.
+        std::array<float, 16> scale{}; ///< Обратные стандартные отклонения, 0 - постоянный признак.
+        const float* centroids = nullptr; ///< Центры списков.
+        const uint64_t* listOffsets = nullptr; ///< Границы списков в массиве векторов.
+        const float* vectors = nullptr; ///< Нормированные векторы.
+        const uint64_t* nameOffsets = nullptr; ///< Границы имён.
+        const char* nameData = nullptr; ///< Имена изображений подряд.
+    };
+}
+
+#endif